@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dbglog/dbglog.hpp"
+
+#include "./compute.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+std::array< ::GLuint, 3> workGroupSize(const Program &program)
+{
+    program.check();
+
+    ::GLint size[3] = { 0, 0, 0 };
+    ::glGetProgramiv(program.get(), GL_COMPUTE_WORK_GROUP_SIZE, size);
+    checkGl("compute work group size");
+
+    return {{ ::GLuint(size[0]), ::GLuint(size[1]), ::GLuint(size[2]) }};
+}
+
+void dispatch(::GLuint x, ::GLuint y, ::GLuint z)
+{
+    ::glDispatchCompute(x, y, z);
+    checkGl("dispatch compute");
+}
+
+void dispatchCovering(const Program &program, ::GLuint width
+                      , ::GLuint height, ::GLuint depth)
+{
+    const auto local(workGroupSize(program));
+    if (!local[0] || !local[1] || !local[2]) {
+        LOGTHROW(err2, Error) << "Program " << program.get()
+                              << " is not a compute program.";
+    }
+
+    const auto groups([](::GLuint size, ::GLuint local) {
+        return (size + local - 1) / local;
+    });
+
+    program.use();
+    dispatch(groups(width, local[0]), groups(height, local[1])
+             , groups(depth, local[2]));
+}
+
+void dispatchIndirect(::GLintptr offset)
+{
+    ::glDispatchComputeIndirect(offset);
+    checkGl("dispatch compute indirect");
+}
+
+void bindImage(::GLuint unit, ::GLuint texture, ::GLenum access
+               , ::GLenum format, ::GLint level)
+{
+    ::glBindImageTexture(unit, texture, level, GL_FALSE, 0, access, format);
+    checkGl("bind image texture");
+}
+
+void memoryBarrier(::GLbitfield barriers)
+{
+    ::glMemoryBarrier(barriers);
+}
+
+} // namespace glsupport
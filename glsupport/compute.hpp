@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef compute_hpp_included_
+#define compute_hpp_included_
+
+#include <array>
+
+#include "utility/gl.hpp"
+
+#include "./shader.hpp"
+
+namespace glsupport {
+
+/** Local work group size (layout(local_size_x...) in) of compute program.
+ */
+std::array< ::GLuint, 3> workGroupSize(const Program &program);
+
+/** Dispatches given number of work groups of currently used compute
+ *  program.
+ */
+void dispatch(::GLuint x, ::GLuint y = 1, ::GLuint z = 1);
+
+/** Uses compute program and dispatches enough work groups to cover
+ *  width x height x depth invocations (e.g. one invocation per pixel).
+ *  Shader must discard out of range invocations itself.
+ */
+void dispatchCovering(const Program &program, ::GLuint width
+                      , ::GLuint height = 1, ::GLuint depth = 1);
+
+/** Dispatches currently used compute program with work group counts read
+ *  from GL_DISPATCH_INDIRECT_BUFFER at given offset.
+ */
+void dispatchIndirect(::GLintptr offset = 0);
+
+/** Binds texture level to image unit for image load/store.
+ *
+ * \param unit image unit
+ * \param texture texture (e.g. FrameBuffer::colorTexture())
+ * \param access GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE
+ * \param format image format, must match shader's format qualifier
+ * \param level texture level
+ */
+void bindImage(::GLuint unit, ::GLuint texture, ::GLenum access
+               , ::GLenum format, ::GLint level = 0);
+
+/** Orders memory accesses (glMemoryBarrier): makes writes by previous
+ *  shaders visible to subsequent operations of given kinds.
+ */
+void memoryBarrier(::GLbitfield barriers = GL_ALL_BARRIER_BITS);
+
+/** Compute results read by image load/store.
+ */
+inline void imageBarrier()
+{
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+/** Compute results read by shader storage buffer access.
+ */
+inline void storageBarrier()
+{
+    memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/** Compute results read by texture sampling.
+ */
+inline void textureFetchBarrier()
+{
+    memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+/** Compute results read back to client or pixel buffer
+ *  (glReadPixels, glGetTexImage).
+ */
+inline void pixelBufferBarrier()
+{
+    memoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT
+                  | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+/** Compute results used as framebuffer attachments.
+ */
+inline void framebufferBarrier()
+{
+    memoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+} // namespace glsupport
+
+#endif // compute_hpp_included_
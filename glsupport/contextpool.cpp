@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mutex>
+#include <condition_variable>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./contextpool.hpp"
+
+namespace glsupport { namespace egl {
+
+struct ContextPool::Lease::Entry {
+    Context context;
+    Surface surface;
+
+    Entry(const Context &context, const Surface &surface)
+        : context(context), surface(surface)
+    {}
+};
+
+struct ContextPool::Detail {
+    typedef std::shared_ptr<Lease::Entry> EntryPtr;
+
+    Display dpy;
+    ::EGLConfig config;
+    std::vector< ::EGLint> attributes;
+
+    /** Client API bound at pool creation. Bound API is per-thread state.
+     */
+    ::EGLenum api;
+
+    /** Contexts can be made current without surface.
+     */
+    bool surfaceless;
+    std::size_t limit;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<EntryPtr> idle;
+    std::size_t created;
+
+    /** First context, all other contexts share objects with it.
+     */
+    Context root;
+
+    Detail(const Display &dpy, ::EGLConfig config
+           , const ::EGLint *contextAttributes, std::size_t limit)
+        : dpy(dpy), config(config), api(::eglQueryAPI())
+        , surfaceless(dpy.hasExtension("EGL_KHR_surfaceless_context"))
+        , limit(limit), created(1)
+    {
+        if (contextAttributes) {
+            for (; *contextAttributes != EGL_NONE; contextAttributes += 2) {
+                attributes.push_back(contextAttributes[0]);
+                attributes.push_back(contextAttributes[1]);
+            }
+            attributes.push_back(EGL_NONE);
+        }
+
+        // create share group root right away
+        auto entry(create());
+        root = entry->context;
+        idle.push_back(entry);
+    }
+
+    void bindApi() const {
+        if (!::eglBindAPI(api)) {
+            LOGTHROW(err2, Error)
+                << "EGL: Cannot bind client API " << api
+                << " (" << detail::error() << ").";
+        }
+    }
+
+    EntryPtr create() {
+        bindApi();
+        auto ctx(egl::context(dpy, config
+                              , (attributes.empty()
+                                 ? nullptr : attributes.data())
+                              , root));
+        if (surfaceless) {
+            return std::make_shared<Lease::Entry>(ctx, Surface());
+        }
+
+        return std::make_shared<Lease::Entry>
+            (ctx, pbuffer(dpy, config, { EGL_WIDTH, 1, EGL_HEIGHT, 1
+                                         , EGL_NONE }));
+    }
+
+    EntryPtr get(bool wait);
+
+    void put(const EntryPtr &entry);
+};
+
+ContextPool::Detail::EntryPtr ContextPool::Detail::get(bool wait)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (!idle.empty()) {
+            auto entry(idle.back());
+            idle.pop_back();
+            return entry;
+        }
+
+        if (!limit || (created < limit)) {
+            // reserve slot and create context outside the lock
+            ++created;
+            lock.unlock();
+            try {
+                return create();
+            } catch (...) {
+                lock.lock();
+                --created;
+                cond.notify_one();
+                throw;
+            }
+        }
+
+        if (!wait) { return {}; }
+        cond.wait(lock);
+    }
+}
+
+void ContextPool::Detail::put(const EntryPtr &entry)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.push_back(entry);
+    }
+    cond.notify_one();
+}
+
+ContextPool::ContextPool(const Display &dpy, ::EGLConfig config
+                         , const ::EGLint *contextAttributes
+                         , std::size_t limit)
+    : detail_(std::make_shared<Detail>(dpy, config, contextAttributes
+                                       , limit))
+{}
+
+ContextPool::ContextPool(const Display &dpy, ::EGLConfig config
+                         , const std::initializer_list< ::EGLint>
+                         &contextAttributes
+                         , std::size_t limit)
+    : detail_(std::make_shared<Detail>(dpy, config
+                                       , asEglAttributes(contextAttributes)
+                                       , limit))
+{}
+
+ContextPool::Lease ContextPool::checkout()
+{
+    return Lease(detail_, detail_->get(true));
+}
+
+ContextPool::Lease ContextPool::tryCheckout()
+{
+    auto entry(detail_->get(false));
+    if (!entry) { return {}; }
+    return Lease(detail_, entry);
+}
+
+std::size_t ContextPool::size() const
+{
+    std::unique_lock<std::mutex> lock(detail_->mutex);
+    return detail_->created;
+}
+
+const Display& ContextPool::display() const
+{
+    return detail_->dpy;
+}
+
+ContextPool::Lease::Lease(const std::shared_ptr<Detail> &detail
+                          , const std::shared_ptr<Entry> &entry)
+    : detail_(detail), entry_(entry)
+{
+    try {
+        detail_->bindApi();
+        entry_->context.makeCurrent(entry_->surface);
+    } catch (...) {
+        detail_->put(entry_);
+        throw;
+    }
+}
+
+ContextPool::Lease::~Lease()
+{
+    release();
+}
+
+ContextPool::Lease& ContextPool::Lease::operator=(Lease &&o)
+{
+    if (this != &o) {
+        release();
+        detail_ = std::move(o.detail_);
+        entry_ = std::move(o.entry_);
+    }
+    return *this;
+}
+
+const Context& ContextPool::Lease::context() const
+{
+    return entry_->context;
+}
+
+const Surface& ContextPool::Lease::surface() const
+{
+    return entry_->surface;
+}
+
+void ContextPool::Lease::release()
+{
+    if (!detail_) { return; }
+
+    try {
+        entry_->context.release();
+    } catch (const std::exception &e) {
+        LOG(err2) << "EGL: Failed to release pooled context: "
+                  << e.what();
+    }
+
+    detail_->put(entry_);
+    detail_.reset();
+    entry_.reset();
+}
+
+} } // namespace glsupport::egl
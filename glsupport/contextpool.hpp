@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef contextpool_hpp_included_
+#define contextpool_hpp_included_
+
+#include <memory>
+#include <vector>
+
+#include "./egl.hpp"
+
+namespace glsupport { namespace egl {
+
+/** Pool of EGL contexts sharing single share group.
+ *
+ *  Contexts are created lazily, up to given limit. When display supports
+ *  EGL_KHR_surfaceless_context contexts are made current without any
+ *  surface, otherwise each context gets its own 1x1 pbuffer. All pooled
+ *  contexts share objects (programs, textures, buffers...) with the first
+ *  one, therefore anything created in one pooled context can be used in any
+ *  other.
+ *
+ *  Pool keeps its display alive. Leases may outlive the pool.
+ *
+ *  Usage (in worker thread):
+ *      auto lease(pool.checkout());
+ *      // context is current in this thread now
+ *      render();
+ *      // context is released and returned to the pool at scope end
+ */
+class ContextPool {
+public:
+    class Lease;
+
+    /** Creates pool.
+     *
+     * \param dpy display
+     * \param config configuration used for all contexts and surfaces
+     * \param contextAttributes EGL_NONE-terminated list of context
+     *                          attributes (or nullptr)
+     * \param limit maximum number of contexts, 0 = unlimited
+     */
+    ContextPool(const Display &dpy, ::EGLConfig config
+                , const ::EGLint *contextAttributes = nullptr
+                , std::size_t limit = 0);
+
+    ContextPool(const Display &dpy, ::EGLConfig config
+                , const std::initializer_list< ::EGLint> &contextAttributes
+                , std::size_t limit = 0);
+
+    /** Checks out a context and makes it current in calling thread. Blocks
+     *  while all contexts are in use and limit has been reached.
+     */
+    Lease checkout();
+
+    /** Non-blocking variant of checkout. Returns invalid lease when no
+     *  context is available.
+     */
+    Lease tryCheckout();
+
+    /** Number of contexts created so far.
+     */
+    std::size_t size() const;
+
+    const Display& display() const;
+
+private:
+    struct Detail;
+    std::shared_ptr<Detail> detail_;
+};
+
+/** Context checked out from a pool. Returned to the pool when destroyed.
+ */
+class ContextPool::Lease {
+public:
+    Lease() {}
+    Lease(Lease &&o) = default;
+    Lease& operator=(Lease &&o);
+    ~Lease();
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    const Context& context() const;
+
+    /** Context's surface, empty for surfaceless context.
+     */
+    const Surface& surface() const;
+
+    /** Releases context from calling thread and returns it to the pool.
+     */
+    void release();
+
+    explicit operator bool() const { return bool(detail_); }
+
+private:
+    friend class ContextPool;
+    struct Entry;
+
+    Lease(const std::shared_ptr<Detail> &detail
+          , const std::shared_ptr<Entry> &entry);
+
+    std::shared_ptr<Detail> detail_;
+    std::shared_ptr<Entry> entry_;
+};
+
+} } // namespace glsupport::egl
+
+#endif // contextpool_hpp_included_
@@ -0,0 +1,637 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define GLSUPPORT_CONVERT_X86 1
+#  include <immintrin.h>
+#endif
+
+#include "dbglog/dbglog.hpp"
+
+#include "./convert.hpp"
+
+namespace glsupport {
+
+namespace {
+
+typedef std::uint8_t Byte;
+
+/** Conversion kernels. Pixel counts are in pixels, component counts in
+ *  components.
+ */
+struct Kernels {
+    /** Clamps to [0, 1] and scales to [0, 255], n components.
+     */
+    void (*floatToByte)(const float *src, Byte *dst, std::size_t n);
+
+    /** IEEE half to single precision float, n components.
+     */
+    void (*halfToFloat)(const std::uint16_t *src, float *dst
+                        , std::size_t n);
+
+    /** In-place premultiplied to straight alpha, n RGBA pixels.
+     */
+    void (*unpremultiply)(Byte *data, std::size_t n);
+
+    /** RGBA to BGRA, n pixels.
+     */
+    void (*rgbaToBgra)(const Byte *src, Byte *dst, std::size_t n);
+
+    /** RGBA to RGB/BGR (alpha dropped), n pixels.
+     */
+    void (*rgbaToRgb)(const Byte *src, Byte *dst, std::size_t n);
+    void (*rgbaToBgr)(const Byte *src, Byte *dst, std::size_t n);
+};
+
+// scalar kernels
+
+inline Byte floatToByte(float value)
+{
+    if (!(value > 0.f)) { return 0; } // NaN as well
+    if (value >= 1.f) { return 255; }
+    return Byte(std::lrint(value * 255.f));
+}
+
+void floatToByteScalar(const float *src, Byte *dst, std::size_t n)
+{
+    for (const auto *end(src + n); src != end; ) {
+        *dst++ = floatToByte(*src++);
+    }
+}
+
+inline float halfToFloat(std::uint16_t h)
+{
+    std::uint32_t sign((std::uint32_t(h) & 0x8000) << 16);
+    std::uint32_t exp((h >> 10) & 0x1f);
+    std::uint32_t mantissa(h & 0x3ff);
+
+    std::uint32_t bits;
+    if (!exp) {
+        if (!mantissa) {
+            bits = sign;
+        } else {
+            // subnormal, normalize
+            exp = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) { mantissa <<= 1; --exp; }
+            bits = sign | (exp << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exp + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void halfToFloatScalar(const std::uint16_t *src, float *dst, std::size_t n)
+{
+    for (const auto *end(src + n); src != end; ) {
+        *dst++ = halfToFloat(*src++);
+    }
+}
+
+/** Same arithmetic as vector kernels to get identical results.
+ */
+inline Byte unpremultiply(Byte value, float scale)
+{
+    const auto v(std::lrint(value * scale));
+    return Byte((v > 255) ? 255 : v);
+}
+
+void unpremultiplyScalar(Byte *data, std::size_t n)
+{
+    for (auto *end(data + 4 * n); data != end; data += 4) {
+        const auto a(data[3]);
+        if (a == 255) { continue; }
+        if (!a) { data[0] = data[1] = data[2] = 0; continue; }
+        const float scale(255.f / a);
+        data[0] = unpremultiply(data[0], scale);
+        data[1] = unpremultiply(data[1], scale);
+        data[2] = unpremultiply(data[2], scale);
+    }
+}
+
+void rgbaToBgraScalar(const Byte *src, Byte *dst, std::size_t n)
+{
+    for (const auto *end(src + 4 * n); src != end; src += 4, dst += 4) {
+        dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = src[3];
+    }
+}
+
+void rgbaToRgbScalar(const Byte *src, Byte *dst, std::size_t n)
+{
+    for (const auto *end(src + 4 * n); src != end; src += 4, dst += 3) {
+        dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2];
+    }
+}
+
+void rgbaToBgrScalar(const Byte *src, Byte *dst, std::size_t n)
+{
+    for (const auto *end(src + 4 * n); src != end; src += 4, dst += 3) {
+        dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0];
+    }
+}
+
+const Kernels scalarKernels = {
+    &floatToByteScalar, &halfToFloatScalar, &unpremultiplyScalar
+    , &rgbaToBgraScalar, &rgbaToRgbScalar, &rgbaToBgrScalar
+};
+
+#ifdef GLSUPPORT_CONVERT_X86
+
+// SSE2 kernels
+
+/** Scales to [0, 255] and clamps; NaN gives 0 (maxps returns the second
+ *  operand for NaN).
+ */
+__attribute__((target("sse2")))
+inline __m128 scaleSse2(__m128 value)
+{
+    return _mm_min_ps(_mm_max_ps(_mm_mul_ps(value, _mm_set1_ps(255.f))
+                                 , _mm_setzero_ps())
+                      , _mm_set1_ps(255.f));
+}
+
+__attribute__((target("sse2")))
+void floatToByteSse2(const float *src, Byte *dst, std::size_t n)
+{
+    std::size_t i(0);
+    for (; i + 16 <= n; i += 16) {
+        const auto a(_mm_cvtps_epi32(scaleSse2(_mm_loadu_ps(src + i))));
+        const auto b(_mm_cvtps_epi32(scaleSse2(_mm_loadu_ps(src + i + 4))));
+        const auto c(_mm_cvtps_epi32(scaleSse2(_mm_loadu_ps(src + i + 8))));
+        const auto d(_mm_cvtps_epi32(scaleSse2(_mm_loadu_ps(src + i + 12))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i)
+                         , _mm_packus_epi16(_mm_packs_epi32(a, b)
+                                            , _mm_packs_epi32(c, d)));
+    }
+    floatToByteScalar(src + i, dst + i, n - i);
+}
+
+/** Unpremultiplies single RGBA pixel held as 4 floats.
+ */
+__attribute__((target("sse2")))
+inline __m128 unpremultiplyPixel(__m128 pixel)
+{
+    // broadcast alpha, scale = 255 / a (0 for a == 0), keep alpha
+    const auto alpha(_mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3)));
+    const auto zero(_mm_cmpeq_ps(alpha, _mm_setzero_ps()));
+    const auto scale(_mm_andnot_ps(zero, _mm_div_ps(_mm_set1_ps(255.f)
+                                                     , alpha)));
+    const auto alphaMask(_mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)));
+    return _mm_or_ps(_mm_and_ps(alphaMask, pixel)
+                     , _mm_andnot_ps(alphaMask, _mm_mul_ps(pixel, scale)));
+}
+
+__attribute__((target("sse2")))
+void unpremultiplySse2(Byte *data, std::size_t n)
+{
+    const auto zero(_mm_setzero_si128());
+    std::size_t i(0);
+    for (; i + 4 <= n; i += 4) {
+        auto *p(reinterpret_cast<__m128i*>(data + 4 * i));
+        const auto in(_mm_loadu_si128(p));
+
+        const auto lo(_mm_unpacklo_epi8(in, zero));
+        const auto hi(_mm_unpackhi_epi8(in, zero));
+
+        const auto p0(unpremultiplyPixel
+                      (_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero))));
+        const auto p1(unpremultiplyPixel
+                      (_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero))));
+        const auto p2(unpremultiplyPixel
+                      (_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero))));
+        const auto p3(unpremultiplyPixel
+                      (_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero))));
+
+        _mm_storeu_si128
+            (p, _mm_packus_epi16
+             (_mm_packs_epi32(_mm_cvtps_epi32(p0), _mm_cvtps_epi32(p1))
+              , _mm_packs_epi32(_mm_cvtps_epi32(p2), _mm_cvtps_epi32(p3))));
+    }
+    unpremultiplyScalar(data + 4 * i, n - i);
+}
+
+__attribute__((target("sse2")))
+void rgbaToBgraSse2(const Byte *src, Byte *dst, std::size_t n)
+{
+    // 0xAABBGGRR -> 0xAARRGGBB
+    const auto ga(_mm_set1_epi32(0xff00ff00));
+    const auto low(_mm_set1_epi32(0xff));
+    std::size_t i(0);
+    for (; i + 4 <= n; i += 4) {
+        const auto in(_mm_loadu_si128
+                      (reinterpret_cast<const __m128i*>(src + 4 * i)));
+        const auto out
+            (_mm_or_si128(_mm_and_si128(in, ga)
+                          , _mm_or_si128
+                          (_mm_and_si128(_mm_srli_epi32(in, 16), low)
+                           , _mm_slli_epi32(_mm_and_si128(in, low), 16))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), out);
+    }
+    rgbaToBgraScalar(src + 4 * i, dst + 4 * i, n - i);
+}
+
+// AVX2 kernels
+
+__attribute__((target("avx2")))
+inline __m256 scaleAvx2(__m256 value)
+{
+    return _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps
+                                       (value, _mm256_set1_ps(255.f))
+                                       , _mm256_setzero_ps())
+                         , _mm256_set1_ps(255.f));
+}
+
+__attribute__((target("avx2")))
+void floatToByteAvx2(const float *src, Byte *dst, std::size_t n)
+{
+    // undo lane interleaving of pack instructions
+    const auto order(_mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+    std::size_t i(0);
+    for (; i + 32 <= n; i += 32) {
+        const auto a(_mm256_cvtps_epi32(scaleAvx2(_mm256_loadu_ps(src + i))));
+        const auto b(_mm256_cvtps_epi32
+                     (scaleAvx2(_mm256_loadu_ps(src + i + 8))));
+        const auto c(_mm256_cvtps_epi32
+                     (scaleAvx2(_mm256_loadu_ps(src + i + 16))));
+        const auto d(_mm256_cvtps_epi32
+                     (scaleAvx2(_mm256_loadu_ps(src + i + 24))));
+        const auto packed
+            (_mm256_packus_epi16(_mm256_packs_epi32(a, b)
+                                 , _mm256_packs_epi32(c, d)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i)
+                            , _mm256_permutevar8x32_epi32(packed, order));
+    }
+    floatToByteSse2(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2,f16c")))
+void halfToFloatAvx2(const std::uint16_t *src, float *dst, std::size_t n)
+{
+    std::size_t i(0);
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps
+                         (_mm_loadu_si128
+                          (reinterpret_cast<const __m128i*>(src + i))));
+    }
+    halfToFloatScalar(src + i, dst + i, n - i);
+}
+
+/** Unpremultiplies 2 RGBA pixels (8 bytes), returns 8 integers.
+ */
+__attribute__((target("avx2")))
+inline __m256i unpremultiplyPixels(const Byte *p)
+{
+    const auto pixel(_mm256_cvtepi32_ps
+                     (_mm256_cvtepu8_epi32
+                      (_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)))));
+
+    const auto alpha(_mm256_shuffle_ps(pixel, pixel
+                                       , _MM_SHUFFLE(3, 3, 3, 3)));
+    const auto zero(_mm256_cmp_ps(alpha, _mm256_setzero_ps(), _CMP_EQ_OQ));
+    const auto scale(_mm256_andnot_ps
+                     (zero, _mm256_div_ps(_mm256_set1_ps(255.f), alpha)));
+    const auto alphaMask(_mm256_castsi256_ps
+                         (_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1)));
+    return _mm256_cvtps_epi32
+        (_mm256_blendv_ps(_mm256_mul_ps(pixel, scale), pixel, alphaMask));
+}
+
+__attribute__((target("avx2")))
+void unpremultiplyAvx2(Byte *data, std::size_t n)
+{
+    const auto order(_mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+    std::size_t i(0);
+    for (; i + 8 <= n; i += 8) {
+        auto *p(data + 4 * i);
+        const auto a(unpremultiplyPixels(p));
+        const auto b(unpremultiplyPixels(p + 8));
+        const auto c(unpremultiplyPixels(p + 16));
+        const auto d(unpremultiplyPixels(p + 24));
+        const auto packed
+            (_mm256_packus_epi16(_mm256_packs_epi32(a, b)
+                                 , _mm256_packs_epi32(c, d)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p)
+                            , _mm256_permutevar8x32_epi32(packed, order));
+    }
+    unpremultiplySse2(data + 4 * i, n - i);
+}
+
+__attribute__((target("avx2")))
+void rgbaToBgraAvx2(const Byte *src, Byte *dst, std::size_t n)
+{
+    const auto shuffle(_mm256_setr_epi8
+                       (2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15
+                        , 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12
+                        , 15));
+    std::size_t i(0);
+    for (; i + 8 <= n; i += 8) {
+        const auto in(_mm256_loadu_si256
+                      (reinterpret_cast<const __m256i*>(src + 4 * i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i)
+                            , _mm256_shuffle_epi8(in, shuffle));
+    }
+    rgbaToBgraSse2(src + 4 * i, dst + 4 * i, n - i);
+}
+
+/** Packs 16 RGBA pixels into 48 bytes, shuffle drops alpha of 4 pixels
+ *  into low 12 bytes.
+ */
+__attribute__((target("avx2")))
+inline void dropAlpha(const Byte *src, Byte *dst, std::size_t n
+                      , __m128i shuffle)
+{
+    std::size_t i(0);
+    for (; i + 16 <= n; i += 16) {
+        const auto *in(reinterpret_cast<const __m128i*>(src + 4 * i));
+        const auto a(_mm_shuffle_epi8(_mm_loadu_si128(in), shuffle));
+        const auto b(_mm_shuffle_epi8(_mm_loadu_si128(in + 1), shuffle));
+        const auto c(_mm_shuffle_epi8(_mm_loadu_si128(in + 2), shuffle));
+        const auto d(_mm_shuffle_epi8(_mm_loadu_si128(in + 3), shuffle));
+
+        auto *out(reinterpret_cast<__m128i*>(dst + 3 * i));
+        _mm_storeu_si128(out, _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(b, 4)
+                                               , _mm_slli_si128(c, 8)));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(c, 8)
+                                               , _mm_slli_si128(d, 4)));
+    }
+}
+
+__attribute__((target("avx2")))
+void rgbaToRgbAvx2(const Byte *src, Byte *dst, std::size_t n)
+{
+    dropAlpha(src, dst, n, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10
+                                         , 12, 13, 14, -1, -1, -1, -1));
+    const auto done(n & ~std::size_t(15));
+    rgbaToRgbScalar(src + 4 * done, dst + 3 * done, n - done);
+}
+
+__attribute__((target("avx2")))
+void rgbaToBgrAvx2(const Byte *src, Byte *dst, std::size_t n)
+{
+    dropAlpha(src, dst, n, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8
+                                         , 14, 13, 12, -1, -1, -1, -1));
+    const auto done(n & ~std::size_t(15));
+    rgbaToBgrScalar(src + 4 * done, dst + 3 * done, n - done);
+}
+
+const Kernels sse2Kernels = {
+    &floatToByteSse2, &halfToFloatScalar, &unpremultiplySse2
+    , &rgbaToBgraSse2, &rgbaToRgbScalar, &rgbaToBgrScalar
+};
+
+const Kernels avx2Kernels = {
+    &floatToByteAvx2, &halfToFloatAvx2, &unpremultiplyAvx2
+    , &rgbaToBgraAvx2, &rgbaToRgbAvx2, &rgbaToBgrAvx2
+};
+
+#endif // GLSUPPORT_CONVERT_X86
+
+Simd supportedSimd()
+{
+#ifdef GLSUPPORT_CONVERT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+        return Simd::avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) { return Simd::sse2; }
+#endif
+    return Simd::scalar;
+}
+
+const Kernels& kernels(Simd simd)
+{
+    switch (simd) {
+    case Simd::scalar: break;
+#ifdef GLSUPPORT_CONVERT_X86
+    case Simd::sse2: return sse2Kernels;
+    case Simd::avx2: return avx2Kernels;
+#else
+    default: break;
+#endif
+    }
+    return scalarKernels;
+}
+
+const Simd bestSimd(supportedSimd());
+std::atomic<Simd> currentSimd(bestSimd);
+
+/** Source pixel: number of components and their encoding.
+ */
+struct Source {
+    enum Encoding { byte, float32, float16, packed11_11_10 };
+
+    int channels;
+    Encoding encoding;
+    bool alpha;
+};
+
+Source source(PixelType pixelType)
+{
+    switch (pixelType) {
+    case PixelType::rgb8: return { 3, Source::byte, false };
+    case PixelType::rgba8: return { 4, Source::byte, true };
+    case PixelType::rgb32f: return { 3, Source::float32, false };
+    case PixelType::rgba32f: return { 4, Source::float32, true };
+    case PixelType::r8: return { 1, Source::byte, false };
+    case PixelType::rg8: return { 2, Source::byte, false };
+    case PixelType::r16f: return { 1, Source::float16, false };
+    case PixelType::rg16f: return { 2, Source::float16, false };
+    case PixelType::r32f: return { 1, Source::float32, false };
+    case PixelType::rg32f: return { 2, Source::float32, false };
+    case PixelType::rgb16f: return { 3, Source::float16, false };
+    case PixelType::rgba16f: return { 4, Source::float16, true };
+    // value bytes taken as is
+    case PixelType::r32ui: return { 4, Source::byte, false };
+    case PixelType::r11g11b10f: return { 3, Source::packed11_11_10, false };
+    }
+    return { 3, Source::byte, false };
+}
+
+/** Unsigned float with 5 bit exponent and given mantissa width.
+ */
+inline float unsignedFloat(std::uint32_t bits, int mantissaBits)
+{
+    const auto mantissa(bits & ((1u << mantissaBits) - 1));
+    const int exp(bits >> mantissaBits);
+    const float m(float(mantissa) / float(1u << mantissaBits));
+    if (!exp) { return std::ldexp(m, -14); }
+    if (exp == 0x1f) { return mantissa ? NAN : INFINITY; }
+    return std::ldexp(1.f + m, exp - 15);
+}
+
+void unpack11_11_10(const std::uint32_t *src, float *dst, std::size_t n)
+{
+    for (const auto *end(src + n); src != end; ++src) {
+        const auto v(*src);
+        *dst++ = unsignedFloat(v & 0x7ff, 6);
+        *dst++ = unsignedFloat((v >> 11) & 0x7ff, 6);
+        *dst++ = unsignedFloat(v >> 22, 5);
+    }
+}
+
+/** Writes row of bytes with given number of channels in given layout.
+ */
+void store(const Kernels &k, const Byte *src, int channels, Byte *dst
+           , Layout layout, std::size_t n)
+{
+    if (channels == 4) {
+        switch (layout) {
+        case Layout::rgba8: std::memcpy(dst, src, 4 * n); return;
+        case Layout::bgra8: k.rgbaToBgra(src, dst, n); return;
+        case Layout::rgb8: k.rgbaToRgb(src, dst, n); return;
+        case Layout::bgr8: k.rgbaToBgr(src, dst, n); return;
+        }
+    }
+
+    if ((channels == 3) && (layout == Layout::rgb8)) {
+        std::memcpy(dst, src, 3 * n);
+        return;
+    }
+
+    // generic path
+    const bool bgr((layout == Layout::bgr8) || (layout == Layout::bgra8));
+    const bool alpha((layout == Layout::rgba8) || (layout == Layout::bgra8));
+    for (const auto *end(src + channels * n); src != end; src += channels) {
+        // gray by default
+        Byte r(src[0]), g(src[0]), b(src[0]), a(255);
+        if (channels >= 2) { g = src[1]; b = 0; }
+        if (channels >= 3) { b = src[2]; }
+        if (channels == 4) { a = src[3]; }
+
+        *dst++ = bgr ? b : r;
+        *dst++ = g;
+        *dst++ = bgr ? r : b;
+        if (alpha) { *dst++ = a; }
+    }
+}
+
+} // namespace
+
+std::size_t layoutSize(Layout layout)
+{
+    switch (layout) {
+    case Layout::rgb8: case Layout::bgr8: return 3;
+    case Layout::rgba8: case Layout::bgra8: return 4;
+    }
+    return 0;
+}
+
+Simd simd()
+{
+    return currentSimd;
+}
+
+Simd simd(Simd limit)
+{
+    const auto s((int(limit) < int(bestSimd)) ? limit : bestSimd);
+    currentSimd = s;
+    return s;
+}
+
+void convert(const void *src, std::size_t srcStride, PixelType pixelType
+             , void *dst, std::size_t dstStride, const math::Size2 &size
+             , const Conversion &conversion)
+{
+    if ((size.width <= 0) || (size.height <= 0)) { return; }
+
+    const auto &k(kernels(currentSimd));
+    const auto s(source(pixelType));
+    const std::size_t width(size.width);
+    const std::size_t components(width * s.channels);
+    const bool unpremultiply(conversion.unpremultiply && s.alpha);
+
+    // row buffers
+    std::vector<Byte> bytes;
+    if ((s.encoding != Source::byte) || unpremultiply) {
+        bytes.resize(components);
+    }
+    std::vector<float> floats;
+    if ((s.encoding == Source::float16)
+        || (s.encoding == Source::packed11_11_10))
+    {
+        floats.resize(components);
+    }
+
+    const auto *in(static_cast<const Byte*>(src));
+    auto *out(static_cast<Byte*>(dst));
+
+    for (long y(0); y < size.height; ++y) {
+        const auto *row(in + (conversion.flip ? (size.height - 1 - y) : y)
+                        * srcStride);
+
+        // decode to bytes
+        const Byte *data(row);
+        switch (s.encoding) {
+        case Source::byte:
+            if (unpremultiply) {
+                std::memcpy(bytes.data(), row, components);
+                data = bytes.data();
+            }
+            break;
+
+        case Source::float32:
+            k.floatToByte(reinterpret_cast<const float*>(row), bytes.data()
+                          , components);
+            data = bytes.data();
+            break;
+
+        case Source::float16:
+            k.halfToFloat(reinterpret_cast<const std::uint16_t*>(row)
+                          , floats.data(), components);
+            k.floatToByte(floats.data(), bytes.data(), components);
+            data = bytes.data();
+            break;
+
+        case Source::packed11_11_10:
+            unpack11_11_10(reinterpret_cast<const std::uint32_t*>(row)
+                           , floats.data(), width);
+            k.floatToByte(floats.data(), bytes.data(), components);
+            data = bytes.data();
+            break;
+        }
+
+        if (unpremultiply) { k.unpremultiply(bytes.data(), width); }
+
+        store(k, data, s.channels, out + y * dstStride, conversion.layout
+              , width);
+    }
+}
+
+} // namespace glsupport
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef convert_hpp_included_
+#define convert_hpp_included_
+
+#include "math/geometry_core.hpp"
+
+#include "./fb.hpp"
+
+namespace glsupport {
+
+/** 8-bit client pixel layouts produced by convert().
+ */
+enum class Layout {
+    rgb8, bgr8, rgba8, bgra8
+};
+
+/** Size of one pixel of given layout.
+ */
+std::size_t layoutSize(Layout layout);
+
+/** Conversion applied to read pixels.
+ */
+struct Conversion {
+    Layout layout;
+
+    /** Flip rows: bottom-up (GL) to top-down order.
+     */
+    bool flip;
+
+    /** Converts premultiplied alpha to straight alpha. Applies only to
+     *  pixel types with alpha.
+     */
+    bool unpremultiply;
+
+    Conversion(Layout layout = Layout::rgb8, bool flip = true
+               , bool unpremultiply = false)
+        : layout(layout), flip(flip), unpremultiply(unpremultiply)
+    {}
+};
+
+/** Converts pixels in client memory (e.g. Readback::Mapping content) of
+ *  given pixel type into 8-bit layout.
+ *
+ *  Rules:
+ *      * floating point components are clamped to [0, 1] and scaled to
+ *        [0, 255] with rounding
+ *      * single channel is replicated to gray (r, r, r), two channels give
+ *        (r, g, 0)
+ *      * missing alpha is 255
+ *      * r32ui value is stored as its bytes in little endian order (r =
+ *        least significant byte), i.e. the original value can be recovered
+ *        from rgba8 output
+ *
+ *  Hot loops are vectorized (SSE2, AVX2) on x86; kernel set is selected at
+ *  runtime, see simd().
+ *
+ * \param src source pixels
+ * \param srcStride source row stride in bytes
+ * \param pixelType source pixel type
+ * \param dst destination pixels
+ * \param dstStride destination row stride in bytes
+ * \param size image size in pixels
+ * \param conversion conversion to apply
+ */
+void convert(const void *src, std::size_t srcStride, PixelType pixelType
+             , void *dst, std::size_t dstStride, const math::Size2 &size
+             , const Conversion &conversion = Conversion());
+
+/** Instruction set used by convert() kernels.
+ */
+enum class Simd {
+    scalar, sse2, avx2
+};
+
+/** Instruction set currently used by convert(); the best one supported by
+ *  the CPU unless limited.
+ */
+Simd simd();
+
+/** Limits instruction set used by convert() (e.g. for benchmarking).
+ *  Returns instruction set actually used.
+ */
+Simd simd(Simd limit);
+
+} // namespace glsupport
+
+#endif // convert_hpp_included_
@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./debug.hpp"
+#include "./extensions.hpp"
+#include "./ext.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+std::atomic<bool> objectLabels_(false);
+
+/** KHR_debug entry points; core names first, KHR-suffixed (GLES) second.
+ */
+struct Functions {
+    PFNGLDEBUGMESSAGECALLBACKPROC debugMessageCallback;
+    PFNGLDEBUGMESSAGECONTROLPROC debugMessageControl;
+    PFNGLOBJECTLABELPROC objectLabel;
+
+    Functions()
+        : debugMessageCallback
+          (resolve<PFNGLDEBUGMESSAGECALLBACKPROC>("glDebugMessageCallback"))
+        , debugMessageControl
+          (resolve<PFNGLDEBUGMESSAGECONTROLPROC>("glDebugMessageControl"))
+        , objectLabel(resolve<PFNGLOBJECTLABELPROC>("glObjectLabel"))
+    {}
+
+    explicit operator bool() const {
+        return debugMessageCallback && debugMessageControl && objectLabel;
+    }
+
+    template <typename Prototype>
+    static Prototype resolve(const std::string &name) {
+        if (auto fn = egl::ext::eglGetProcAddress<Prototype>
+            (name.c_str(), std::nothrow))
+        {
+            return fn;
+        }
+        return egl::ext::eglGetProcAddress<Prototype>
+            ((name + "KHR").c_str(), std::nothrow);
+    }
+};
+
+const Functions& functions()
+{
+    static Functions functions;
+    return functions;
+}
+
+bool available()
+{
+    return (functions() && hasExtension("GL_KHR_debug"));
+}
+
+const char* sourceName(::GLenum source)
+{
+    switch (source) {
+    case GL_DEBUG_SOURCE_API: return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: break;
+    }
+    return "other";
+}
+
+const char* typeName(::GLenum type)
+{
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated behavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+    case GL_DEBUG_TYPE_MARKER: return "marker";
+    case GL_DEBUG_TYPE_PUSH_GROUP: return "push group";
+    case GL_DEBUG_TYPE_POP_GROUP: return "pop group";
+    default: break;
+    }
+    return "other";
+}
+
+::GLenum severityEnum(DebugSeverity severity)
+{
+    switch (severity) {
+    case DebugSeverity::notification: return GL_DEBUG_SEVERITY_NOTIFICATION;
+    case DebugSeverity::low: return GL_DEBUG_SEVERITY_LOW;
+    case DebugSeverity::medium: return GL_DEBUG_SEVERITY_MEDIUM;
+    case DebugSeverity::high: return GL_DEBUG_SEVERITY_HIGH;
+    }
+    return GL_DEBUG_SEVERITY_HIGH;
+}
+
+void GLAPIENTRY debugCallback(::GLenum source, ::GLenum type, ::GLuint id
+                              , ::GLenum severity, ::GLsizei length
+                              , const ::GLchar *message, const void*)
+{
+    const std::string msg(message, ((length < 0) ? std::strlen(message)
+                                    : std::size_t(length)));
+
+#define GLSUPPORT_DEBUG_LOG(LEVEL)                                      \
+    LOG(LEVEL) << "GL " << typeName(type) << " (" << sourceName(source) \
+               << ", " << id << "): " << msg
+
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: GLSUPPORT_DEBUG_LOG(err2); break;
+    case GL_DEBUG_SEVERITY_MEDIUM: GLSUPPORT_DEBUG_LOG(warn2); break;
+    case GL_DEBUG_SEVERITY_LOW: GLSUPPORT_DEBUG_LOG(warn1); break;
+    default: GLSUPPORT_DEBUG_LOG(info1); break;
+    }
+
+#undef GLSUPPORT_DEBUG_LOG
+}
+
+} // namespace
+
+bool enableDebugOutput(DebugSeverity minSeverity, bool synchronous)
+{
+    if (!available()) {
+        LOG(warn2) << "GL debug output (KHR_debug) not available.";
+        return false;
+    }
+
+    ::GLint flags(0);
+    ::glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+        LOG(info2) << "Not a debug context, GL debug output may be limited.";
+    }
+
+    const auto &fn(functions());
+
+    // everything on, then switch off low severities
+    fn.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE
+                           , 0, nullptr, GL_TRUE);
+    for (auto s(int(DebugSeverity::notification)); s < int(minSeverity); ++s)
+    {
+        fn.debugMessageControl(GL_DONT_CARE, GL_DONT_CARE
+                               , severityEnum(DebugSeverity(s))
+                               , 0, nullptr, GL_FALSE);
+    }
+
+    fn.debugMessageCallback(&debugCallback, nullptr);
+    ::glEnable(GL_DEBUG_OUTPUT);
+    if (synchronous) {
+        ::glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    } else {
+        ::glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+
+    // KHR_debug checked above
+    objectLabels_ = true;
+    checkGl("enable debug output");
+    return true;
+}
+
+void disableDebugOutput()
+{
+    if (!available()) { return; }
+
+    ::glDisable(GL_DEBUG_OUTPUT);
+    functions().debugMessageCallback(nullptr, nullptr);
+    checkGl("disable debug output");
+}
+
+void objectLabels(bool enable)
+{
+    if (enable && !available()) {
+        LOG(warn2) << "GL object labels (KHR_debug) not available.";
+        enable = false;
+    }
+    objectLabels_ = enable;
+}
+
+bool objectLabels()
+{
+    return objectLabels_;
+}
+
+void objectLabel(::GLenum identifier, ::GLuint name
+                 , const std::string &label)
+{
+    // availability checked when labeling was switched on
+    if (!objectLabels_ || !name) { return; }
+    functions().objectLabel(identifier, name, ::GLsizei(label.size())
+                            , label.data());
+}
+
+} // namespace glsupport
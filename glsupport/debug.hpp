@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef debug_hpp_included_
+#define debug_hpp_included_
+
+#include <string>
+
+#include "utility/gl.hpp"
+
+namespace glsupport {
+
+/** Severity of GL debug message.
+ */
+enum class DebugSeverity {
+    notification, low, medium, high
+};
+
+/** Routes GL debug output (KHR_debug) of current context into dbglog:
+ *  high -> err2, medium -> warn2, low -> warn1, notification -> info1.
+ *  Messages below given severity are filtered out by the driver.
+ *
+ *  Full output is guaranteed only in debug contexts, see
+ *  egl::debugContexts(). Also enables object labels (see objectLabel()).
+ *
+ * \param minSeverity minimum reported severity
+ * \param synchronous report messages from within the offending GL call
+ *                    (slower, but the log is in order with other output)
+ * \return false if KHR_debug is not available
+ */
+bool enableDebugOutput(DebugSeverity minSeverity = DebugSeverity::low
+                       , bool synchronous = true);
+
+/** Stops debug output of current context.
+ */
+void disableDebugOutput();
+
+/** Process-wide switch of object labeling. Enabled by enableDebugOutput().
+ *  KHR_debug support is checked once, when labeling is switched on, in the
+ *  context current at that time.
+ */
+void objectLabels(bool enable);
+
+bool objectLabels();
+
+/** Attaches human readable label to GL object (glObjectLabel), shown in
+ *  debug messages and GL debuggers. No-op when labeling is disabled or not
+ *  supported.
+ *
+ * \param identifier object namespace (GL_PROGRAM, GL_FRAMEBUFFER,
+ *                   GL_TEXTURE...)
+ * \param name object name
+ * \param label label
+ */
+void objectLabel(::GLenum identifier, ::GLuint name
+                 , const std::string &label);
+
+} // namespace glsupport
+
+#endif // debug_hpp_included_
@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <algorithm>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./devicescheduler.hpp"
+
+namespace glsupport { namespace egl {
+
+namespace {
+
+/** Job with its promise; promise can be failed without running the job.
+ */
+struct Task {
+    DeviceScheduler::Job job;
+    std::promise<void> promise;
+};
+
+std::future<void> failed(const std::string &error)
+{
+    std::promise<void> promise;
+    promise.set_exception(std::make_exception_ptr(Error(error)));
+    return promise.get_future();
+}
+
+const ::EGLint* attributes(const std::vector< ::EGLint> &attributes)
+{
+    return attributes.empty() ? nullptr : attributes.data();
+}
+
+} // namespace
+
+struct DeviceScheduler::Detail {
+    struct Slot {
+        DeviceInfo info;
+        Display display;
+        ContextPool pool;
+
+        std::condition_variable cond;
+        std::deque<Task> queue;
+        std::size_t running;
+        std::vector<std::thread> threads;
+
+        /** Workers holding a context; device is dead when none is left.
+         */
+        std::size_t alive;
+        std::string error;
+
+        Slot(const Device &device, const Display &display
+             , ::EGLConfig config
+             , const std::vector< ::EGLint> &contextAttributes
+             , std::size_t threads)
+            : info{ device, device.name() }, display(display)
+            , pool(display, config, attributes(contextAttributes), threads)
+            , running(), alive(threads)
+        {}
+
+        std::size_t load() const { return queue.size() + running; }
+
+        bool dead() const { return !alive; }
+    };
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Slot>> slots;
+    bool stop;
+
+    Detail() : stop(false) {}
+
+    ~Detail() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stop = true;
+        }
+
+        for (auto &slot : slots) {
+            slot->cond.notify_all();
+            for (auto &thread : slot->threads) { thread.join(); }
+        }
+    }
+
+    void run(Slot &slot, std::size_t device, std::size_t thread);
+
+    /** Worker failed to get a context. Last one marks the device dead and
+     *  fails its queued jobs. Called under lock.
+     */
+    void lost(Slot &slot, const std::string &error);
+
+    std::future<void> post(Slot &slot, const Job &job) {
+        if (slot.dead()) { return failed(slot.error); }
+
+        slot.queue.push_back({ job, std::promise<void>() });
+        auto future(slot.queue.back().promise.get_future());
+        slot.cond.notify_one();
+        return future;
+    }
+};
+
+void DeviceScheduler::Detail::lost(Slot &slot, const std::string &error)
+{
+    if (--slot.alive) { return; }
+
+    slot.error = ("Device <" + slot.info.name + "> has no usable context: "
+                  + error);
+    LOG(err2) << "Device scheduler: " << slot.error;
+
+    for (auto &task : slot.queue) {
+        task.promise.set_exception(std::make_exception_ptr
+                                   (Error(slot.error)));
+    }
+    slot.queue.clear();
+}
+
+void DeviceScheduler::Detail::run(Slot &slot, std::size_t device
+                                  , std::size_t thread)
+{
+    ContextPool::Lease lease;
+    try {
+        lease = slot.pool.checkout();
+    } catch (const std::exception &e) {
+        LOG(err2) << "Device scheduler worker " << thread << " on <"
+                  << slot.info.name << "> cannot get context: " << e.what();
+        std::unique_lock<std::mutex> lock(mutex);
+        lost(slot, e.what());
+        return;
+    }
+
+    const Worker worker{ device, thread, slot.display, lease };
+
+    LOG(info2) << "Device scheduler worker " << thread << " running on <"
+               << slot.info.name << ">.";
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        slot.cond.wait(lock, [&]() { return stop || !slot.queue.empty(); });
+        if (slot.queue.empty()) { break; }
+
+        auto task(std::move(slot.queue.front()));
+        slot.queue.pop_front();
+        ++slot.running;
+
+        lock.unlock();
+        try {
+            task.job(worker);
+            task.promise.set_value();
+        } catch (...) {
+            task.promise.set_exception(std::current_exception());
+        }
+        lock.lock();
+
+        --slot.running;
+    }
+}
+
+DeviceScheduler::DeviceScheduler(const Device::list &devices
+                                 , const std::vector< ::EGLint>
+                                 &configAttributes
+                                 , const std::vector< ::EGLint>
+                                 &contextAttributes
+                                 , std::size_t threadsPerDevice
+                                 , ::EGLenum api)
+    : detail_(new Detail())
+{
+    if (!threadsPerDevice) {
+        LOGTHROW(err2, Error)
+            << "Device scheduler needs at least one thread per device.";
+    }
+
+    if (!::eglBindAPI(api)) {
+        LOGTHROW(err2, Error)
+            << "EGL: Cannot bind client API " << api
+            << " (" << detail::error() << ").";
+    }
+
+    std::vector< ::EGLDeviceEXT> seen;
+    for (const auto &device : devices) {
+        // the same device maps to the same display, open it only once
+        if (std::find(seen.begin(), seen.end(), device.device)
+            != seen.end())
+        {
+            continue;
+        }
+        seen.push_back(device.device);
+
+        try {
+            Display display(device);
+            auto configs(chooseConfigs(display
+                                       , attributes(configAttributes)));
+            if (configs.empty()) {
+                LOG(warn2) << "EGL: No matching config on device <"
+                           << device.name() << ">, skipping.";
+                continue;
+            }
+
+            detail_->slots.emplace_back
+                (new Detail::Slot(device, display, configs.front()
+                                  , contextAttributes, threadsPerDevice));
+        } catch (const std::exception &e) {
+            LOG(warn2) << "EGL: Cannot use device <" << device.name()
+                       << ">, skipping: " << e.what();
+        }
+    }
+
+    if (detail_->slots.empty()) {
+        LOGTHROW(err2, Error) << "EGL: No usable device.";
+    }
+
+    for (std::size_t d(0); d < detail_->slots.size(); ++d) {
+        auto &slot(*detail_->slots[d]);
+        for (std::size_t t(0); t < threadsPerDevice; ++t) {
+            slot.threads.emplace_back(&Detail::run, detail_.get()
+                                      , std::ref(slot), d, t);
+        }
+    }
+}
+
+DeviceScheduler::~DeviceScheduler() {}
+
+std::future<void> DeviceScheduler::post(const Job &job)
+{
+    std::unique_lock<std::mutex> lock(detail_->mutex);
+
+    // find least loaded live device; all devices have the same number of
+    // workers
+    Detail::Slot *best(nullptr);
+    for (const auto &slot : detail_->slots) {
+        if (slot->dead()) { continue; }
+        if (!best || (slot->load() < best->load())) { best = slot.get(); }
+    }
+
+    if (!best) { return failed("EGL: No live device."); }
+    return detail_->post(*best, job);
+}
+
+std::future<void> DeviceScheduler::post(std::size_t device, const Job &job)
+{
+    std::unique_lock<std::mutex> lock(detail_->mutex);
+    return detail_->post(*detail_->slots.at(device), job);
+}
+
+std::vector<DeviceScheduler::DeviceInfo> DeviceScheduler::devices() const
+{
+    std::vector<DeviceInfo> out;
+    for (const auto &slot : detail_->slots) { out.push_back(slot->info); }
+    return out;
+}
+
+std::size_t DeviceScheduler::load(std::size_t device) const
+{
+    std::unique_lock<std::mutex> lock(detail_->mutex);
+    return detail_->slots.at(device)->load();
+}
+
+} } // namespace glsupport::egl
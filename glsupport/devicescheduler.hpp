@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef devicescheduler_hpp_included_
+#define devicescheduler_hpp_included_
+
+#include <memory>
+#include <vector>
+#include <future>
+#include <functional>
+
+#include "./egl.hpp"
+#include "./contextpool.hpp"
+
+namespace glsupport { namespace egl {
+
+/** Distributes render jobs across EGL devices.
+ *
+ *  Each usable device gets its own display, context pool and a set of worker
+ *  threads, each holding a current context for its whole lifetime. A posted
+ *  job goes to the least loaded device (queued + running jobs).
+ *
+ *  Jobs run with a current context; GL objects can be shared only between
+ *  jobs running on the same device.
+ *
+ *  When all workers of a device fail to get a context the device is dead:
+ *  its queued jobs fail with the checkout error and new jobs go elsewhere.
+ *
+ *  Destructor finishes all queued jobs before joining the workers.
+ */
+class DeviceScheduler {
+public:
+    /** Execution environment passed to a job.
+     */
+    struct Worker {
+        /** Index of device in devices().
+         */
+        std::size_t device;
+
+        /** Index of worker thread within the device.
+         */
+        std::size_t thread;
+
+        const Display &display;
+        const ContextPool::Lease &lease;
+    };
+
+    typedef std::function<void(const Worker&)> Job;
+
+    /** Identification of a scheduled device.
+     */
+    struct DeviceInfo {
+        Device device;
+        std::string name;
+    };
+
+    /** Opens all given devices. Devices that cannot be opened or have no
+     *  matching config are skipped; throws if no device is usable.
+     *
+     * \param devices devices to use (e.g. queryDevices())
+     * \param configAttributes EGL config attributes
+     * \param contextAttributes EGL context attributes
+     * \param threadsPerDevice number of worker threads per device
+     * \param api client API (EGL_OPENGL_API, EGL_OPENGL_ES_API)
+     */
+    DeviceScheduler(const Device::list &devices
+                    , const std::vector< ::EGLint> &configAttributes
+                    , const std::vector< ::EGLint> &contextAttributes
+                    , std::size_t threadsPerDevice = 1
+                    , ::EGLenum api = EGL_OPENGL_API);
+
+    ~DeviceScheduler();
+
+    DeviceScheduler(const DeviceScheduler&) = delete;
+    DeviceScheduler& operator=(const DeviceScheduler&) = delete;
+
+    /** Posts job to least loaded device. Devices whose workers all failed
+     *  to get a context are skipped; future holds an error when there is no
+     *  live device.
+     */
+    std::future<void> post(const Job &job);
+
+    /** Posts job to given device. Future holds an error if the device is
+     *  dead.
+     */
+    std::future<void> post(std::size_t device, const Job &job);
+
+    /** Scheduled devices.
+     */
+    std::vector<DeviceInfo> devices() const;
+
+    /** Number of queued and running jobs on given device.
+     */
+    std::size_t load(std::size_t device) const;
+
+private:
+    struct Detail;
+    std::unique_ptr<Detail> detail_;
+};
+
+} } // namespace glsupport::egl
+
+#endif // devicescheduler_hpp_included_
@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./dmabuf.hpp"
+#include "./ext.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+struct Functions {
+    PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC exportQuery;
+    PFNEGLEXPORTDMABUFIMAGEMESAPROC exportImage;
+
+    Functions()
+        : exportQuery(egl::ext::eglGetProcAddress
+                      <PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC>
+                      ("eglExportDMABUFImageQueryMESA", std::nothrow))
+        , exportImage(egl::ext::eglGetProcAddress
+                      <PFNEGLEXPORTDMABUFIMAGEMESAPROC>
+                      ("eglExportDMABUFImageMESA", std::nothrow))
+    {}
+};
+
+const Functions& functions()
+{
+    static Functions functions;
+    return functions;
+}
+
+/** Per-plane import attributes: fd, offset, pitch, modifier lo/hi.
+ */
+const ::EGLint planeAttributes[][5] = {
+    { EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT
+      , EGL_DMA_BUF_PLANE0_PITCH_EXT, EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT
+      , EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT }
+    , { EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT
+        , EGL_DMA_BUF_PLANE1_PITCH_EXT, EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT
+        , EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT }
+    , { EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT
+        , EGL_DMA_BUF_PLANE2_PITCH_EXT, EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT
+        , EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT }
+    , { EGL_DMA_BUF_PLANE3_FD_EXT, EGL_DMA_BUF_PLANE3_OFFSET_EXT
+        , EGL_DMA_BUF_PLANE3_PITCH_EXT, EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT
+        , EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT }
+};
+
+constexpr std::size_t maxPlanes
+    = sizeof(planeAttributes) / sizeof(planeAttributes[0]);
+
+} // namespace
+
+constexpr std::uint64_t DmaBuf::invalidModifier;
+
+DmaBuf::DmaBuf(DmaBuf &&other)
+    : size(other.size), fourcc(other.fourcc), modifier(other.modifier)
+    , planes(std::move(other.planes))
+{
+    other.planes.clear();
+}
+
+DmaBuf& DmaBuf::operator=(DmaBuf &&other)
+{
+    if (this == &other) { return *this; }
+
+    close();
+    size = other.size;
+    fourcc = other.fourcc;
+    modifier = other.modifier;
+    planes = std::move(other.planes);
+    other.planes.clear();
+    return *this;
+}
+
+void DmaBuf::close()
+{
+    // planes may share one descriptor
+    std::vector<int> closed;
+    for (auto &plane : planes) {
+        if ((plane.fd >= 0)
+            && (std::find(closed.begin(), closed.end(), plane.fd)
+                == closed.end()))
+        {
+            ::close(plane.fd);
+            closed.push_back(plane.fd);
+        }
+        plane.fd = -1;
+    }
+}
+
+DmaBuf exportDmaBuf(const egl::Image &image, const math::Size2 &size)
+{
+    const auto &f(functions());
+    const auto &dpy(image.display());
+    if (!f.exportQuery || !f.exportImage
+        || !dpy.hasExtension("EGL_MESA_image_dma_buf_export"))
+    {
+        LOGTHROW(err2, egl::MissingExtension)
+            << "EGL: EGL_MESA_image_dma_buf_export unavailable.";
+    }
+
+    int fourcc(0), count(0);
+    if (!f.exportQuery(dpy, *image, &fourcc, &count, nullptr)
+        || (count <= 0))
+    {
+        LOGTHROW(err2, egl::Error)
+            << "EGL: Cannot query dma-buf export of image ("
+            << egl::detail::error() << ").";
+    }
+
+    std::vector< ::EGLuint64KHR> modifiers(count, DmaBuf::invalidModifier);
+    f.exportQuery(dpy, *image, &fourcc, &count, modifiers.data());
+
+    std::vector<int> fds(count, -1);
+    std::vector< ::EGLint> strides(count), offsets(count);
+    if (!f.exportImage(dpy, *image, fds.data(), strides.data()
+                       , offsets.data()))
+    {
+        LOGTHROW(err2, egl::Error)
+            << "EGL: Cannot export image as dma-buf ("
+            << egl::detail::error() << ").";
+    }
+
+    DmaBuf buf;
+    buf.size = size;
+    buf.fourcc = fourcc;
+    buf.modifier = modifiers.front();
+    for (int i(0); i < count; ++i) {
+        buf.planes.emplace_back(fds[i], offsets[i], strides[i]);
+    }
+
+    LOG(info1) << "Exported " << size << " image as dma-buf with "
+               << count << " plane(s), fourcc 0x" << std::hex << fourcc
+               << ", modifier 0x" << buf.modifier << std::dec << ".";
+    return buf;
+}
+
+DmaBuf exportDmaBuf(const egl::Display &dpy, const egl::Context &context
+                    , const FrameBuffer &fb, std::size_t attachment)
+{
+    const auto texture(fb.resolvedColorTexture(attachment));
+    if (!texture) {
+        LOGTHROW(err2, Error)
+            << "Framebuffer color attachment " << attachment
+            << " is not a texture.";
+    }
+
+    return exportDmaBuf(egl::Image::fromTexture(dpy, context, texture)
+                        , fb.size());
+}
+
+egl::Image importDmaBuf(const egl::Display &dpy, const DmaBuf &buf)
+{
+    if (!dpy.hasExtension("EGL_EXT_image_dma_buf_import")) {
+        LOGTHROW(err2, egl::MissingExtension)
+            << "EGL: EGL_EXT_image_dma_buf_import unavailable.";
+    }
+
+    if (buf.planes.empty() || (buf.planes.size() > maxPlanes)) {
+        LOGTHROW(err2, Error)
+            << "Invalid number of dma-buf planes: " << buf.planes.size()
+            << ".";
+    }
+
+    const bool explicitModifier
+        (buf.modifier != DmaBuf::invalidModifier);
+    if (explicitModifier
+        && !dpy.hasExtension("EGL_EXT_image_dma_buf_import_modifiers"))
+    {
+        LOGTHROW(err2, egl::MissingExtension)
+            << "EGL: EGL_EXT_image_dma_buf_import_modifiers unavailable.";
+    }
+
+    std::vector< ::EGLint> attributes = {
+        EGL_WIDTH, ::EGLint(buf.size.width)
+        , EGL_HEIGHT, ::EGLint(buf.size.height)
+        , EGL_LINUX_DRM_FOURCC_EXT, buf.fourcc
+    };
+
+    for (std::size_t i(0); i < buf.planes.size(); ++i) {
+        const auto &plane(buf.planes[i]);
+        const auto &names(planeAttributes[i]);
+        attributes.insert(attributes.end(), {
+            names[0], plane.fd
+            , names[1], plane.offset
+            , names[2], plane.stride
+        });
+
+        if (explicitModifier) {
+            attributes.insert(attributes.end(), {
+                names[3], ::EGLint(buf.modifier & 0xffffffff)
+                , names[4], ::EGLint(buf.modifier >> 32)
+            });
+        }
+    }
+    attributes.push_back(EGL_NONE);
+
+    return egl::Image::create(dpy, EGL_LINUX_DMA_BUF_EXT, nullptr
+                              , attributes.data());
+}
+
+Texture importTexture(const egl::Display &dpy, const DmaBuf &buf
+                      , PixelType pixelType)
+{
+    Texture::Params params(buf.size, pixelType);
+    params.minFilter = params.magFilter = GL_NEAREST;
+    return Texture(importDmaBuf(dpy, buf), params);
+}
+
+} // namespace glsupport
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef dmabuf_hpp_included_
+#define dmabuf_hpp_included_
+
+#include <cstdint>
+#include <vector>
+
+#include "math/geometry_core.hpp"
+
+#include "./eglimage.hpp"
+#include "./fb.hpp"
+#include "./texture.hpp"
+
+namespace glsupport {
+
+/** Linux dma-buf image: plane file descriptors and their layout.
+ *
+ *  Owns the descriptors (closed on destruction); move-only. Descriptors can
+ *  be sent to another process (SCM_RIGHTS) together with the rest of the
+ *  description and imported there.
+ */
+struct DmaBuf {
+    struct Plane {
+        int fd;
+        int offset;
+        int stride;
+
+        Plane(int fd = -1, int offset = 0, int stride = 0)
+            : fd(fd), offset(offset), stride(stride)
+        {}
+    };
+
+    typedef std::vector<Plane> Planes;
+
+    /** DRM_FORMAT_MOD_INVALID: layout given by the driver (implicit
+     *  modifier).
+     */
+    static constexpr std::uint64_t invalidModifier = 0x00ffffffffffffffull;
+
+    math::Size2 size;
+
+    /** DRM fourcc format code.
+     */
+    int fourcc;
+
+    /** DRM format modifier (tiling, compression) of all planes.
+     */
+    std::uint64_t modifier;
+
+    Planes planes;
+
+    DmaBuf() : fourcc(), modifier(invalidModifier) {}
+    ~DmaBuf() { close(); }
+
+    DmaBuf(DmaBuf &&other);
+    DmaBuf& operator=(DmaBuf &&other);
+
+    DmaBuf(const DmaBuf&) = delete;
+    DmaBuf& operator=(const DmaBuf&) = delete;
+
+    /** Closes all plane descriptors.
+     */
+    void close();
+};
+
+/** Exports EGL image as dma-buf (EGL_MESA_image_dma_buf_export). EGL images
+ *  do not know their size; it must be provided.
+ */
+DmaBuf exportDmaBuf(const egl::Image &image, const math::Size2 &size);
+
+/** Exports (resolved) color attachment of given framebuffer. Context must
+ *  be the framebuffer's context; color must be texture storage.
+ *
+ *  Export once and render repeatedly: exported buffer shares memory with
+ *  the attachment. Multisampled content must be resolved and rendering
+ *  finished (see Fence) before consumer reads the buffer.
+ */
+DmaBuf exportDmaBuf(const egl::Display &dpy, const egl::Context &context
+                    , const FrameBuffer &fb, std::size_t attachment = 0);
+
+/** Imports dma-buf as EGL image (EGL_EXT_image_dma_buf_import; explicit
+ *  modifier needs EGL_EXT_image_dma_buf_import_modifiers). EGL keeps its
+ *  own references to the buffer, DmaBuf can be closed afterwards.
+ */
+egl::Image importDmaBuf(const egl::Display &dpy, const DmaBuf &buf);
+
+/** Imports dma-buf into texture sharing its memory, see
+ *  Texture(const egl::Image&, const Texture::Params&). Must be called
+ *  with context current.
+ */
+Texture importTexture(const egl::Display &dpy, const DmaBuf &buf
+                      , PixelType pixelType = PixelType::rgba8);
+
+} // namespace glsupport
+
+#endif // dmabuf_hpp_included_
@@ -24,65 +24,20 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <dlfcn.h>
-
 #include <new>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 #include "egl.hpp"
+#include "ext.hpp"
 
 namespace glsupport { namespace egl {
 
 namespace ext {
 
-template <typename Prototype>
-Prototype getProcAddress(const char *name, std::nothrow_t)
-{
-    ::dlerror();
-    auto proc(Prototype(::dlsym(RTLD_DEFAULT, name)));
-    if (auto error = ::dlerror()) {
-        LOG(warn2)
-            << "Unable to get address of EGL function: "
-            << name << ": " << error << ".";
-        return nullptr;
-    }
-    return Prototype(proc);
-}
-
-template <typename Prototype>
-Prototype getProcAddress(const char *name)
-{
-    ::dlerror();
-    auto proc(Prototype(::dlsym(RTLD_DEFAULT, name)));
-    if (auto error = ::dlerror()) {
-        LOGTHROW(err2, MissingExtension)
-            << "Unable to get address of EGL function "
-            << name << ": " << error << ".";
-    }
-    return Prototype(proc);
-}
-
-template <typename Prototype>
-Prototype eglGetProcAddress(const char *name)
-{
-    typedef void* (EGLAPIENTRYP EglGetProcAddress)(const char *procname);
-    static auto loader(getProcAddress<EglGetProcAddress>
-                       ("eglGetProcAddress", std::nothrow));
-
-    if (!loader) {
-        LOGTHROW(err2, MissingExtension)
-            << "EGL: unable to query extensions.";
-    }
-
-    auto proc(Prototype(loader(name)));
-    if (!proc) {
-        LOGTHROW(err2, MissingExtension)
-            << "EGL: unable to get <" << name << "> extension.";
-    }
-
-    return proc;
-}
-
-::EGLDisplay getPlatformDisplay(const Device &device)
+::EGLDisplay getPlatformDisplay(::EGLenum platform, void *nativeDisplay)
 {
     static auto eglGetPlatformDisplayEXT
         (eglGetProcAddress<PFNEGLGETPLATFORMDISPLAYEXTPROC>
@@ -93,8 +48,12 @@ Prototype eglGetProcAddress(const char *name)
             << "EGL: eglGetPlatformDisplayEXT unavailable.";
     }
 
-    return eglGetPlatformDisplayEXT
-        (EGL_PLATFORM_DEVICE_EXT, device.device, nullptr);
+    return eglGetPlatformDisplayEXT(platform, nativeDisplay, nullptr);
+}
+
+::EGLDisplay getPlatformDisplay(const Device &device)
+{
+    return getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device.device);
 }
 
 } // namespace ext
@@ -136,6 +95,67 @@ Device::list queryDevices()
 
 namespace {
 
+std::string queryDeviceString(::EGLDeviceEXT device, ::EGLint name)
+{
+    static auto eglQueryDeviceStringEXT
+        (ext::eglGetProcAddress<PFNEGLQUERYDEVICESTRINGEXTPROC>
+         ("eglQueryDeviceStringEXT", std::nothrow));
+
+    if (!eglQueryDeviceStringEXT) { return {}; }
+
+    auto value(eglQueryDeviceStringEXT(device, name));
+    if (!value) {
+        // swallow EGL_BAD_PARAMETER for unsupported names
+        ::eglGetError();
+        return {};
+    }
+    return value;
+}
+
+} // namespace
+
+std::string Device::extensions() const
+{
+    return queryDeviceString(device, EGL_EXTENSIONS);
+}
+
+bool Device::hasExtension(const std::string &name) const
+{
+    return detail::hasExtension(extensions().c_str(), name);
+}
+
+std::string Device::drmDeviceFile() const
+{
+    if (!hasExtension("EGL_EXT_device_drm")) { return {}; }
+    return queryDeviceString(device, EGL_DRM_DEVICE_FILE_EXT);
+}
+
+std::string Device::drmRenderNode() const
+{
+#ifdef EGL_DRM_RENDER_NODE_FILE_EXT
+    if (!hasExtension("EGL_EXT_device_drm_render_node")) { return {}; }
+    return queryDeviceString(device, EGL_DRM_RENDER_NODE_FILE_EXT);
+#else
+    return {};
+#endif
+}
+
+bool Device::software() const
+{
+    return hasExtension("EGL_MESA_device_software");
+}
+
+std::string Device::name() const
+{
+    auto name(drmRenderNode());
+    if (!name.empty()) { return name; }
+    name = drmDeviceFile();
+    if (!name.empty()) { return name; }
+    return software() ? "software" : "unknown";
+}
+
+namespace {
+
 template <typename What>
 Display::Ptr openDisplay(::EGLDisplay dpy, What what)
 {
@@ -173,6 +193,17 @@ Display::Ptr openDisplay(::EGLDisplay dpy, What what)
     return display;
 }
 
+::EGLDisplay surfacelessDisplay()
+{
+    if (!hasClientExtension("EGL_MESA_platform_surfaceless")) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: surfaceless platform not supported.";
+    }
+
+    return ext::getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA
+                                   , EGL_DEFAULT_DISPLAY);
+}
+
 } // namespace
 
 Display::Display(::EGLNativeDisplayType nativeDisplay)
@@ -183,6 +214,22 @@ Display::Display(const Device &device)
     : dpy_(openDisplay(ext::getPlatformDisplay(device), device.device))
 {}
 
+Display::Display(const Surfaceless&)
+    : dpy_(openDisplay(surfacelessDisplay(), "surfaceless"))
+{}
+
+bool Display::hasExtension(const std::string &name) const
+{
+    return detail::hasExtension
+        (::eglQueryString(dpy_.get(), EGL_EXTENSIONS), name);
+}
+
+bool hasClientExtension(const std::string &name)
+{
+    return detail::hasExtension
+        (::eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), name);
+}
+
 std::vector< ::EGLConfig> getConfigs(const Display &dpy, int limit)
 {
     ::EGLint numConfigs;
@@ -307,12 +354,104 @@ void Context::makeCurrent(const Surface &draw, const Surface &read) const
     }
 }
 
+void Context::makeCurrent() const
+{
+    if (!::eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE
+                          , context_.get()))
+    {
+        LOGTHROW(err1, Error)
+            << "EGL: Cannot make context " << context_
+            << " current without surface on display " << dpy_
+            << " (" << detail::error() << ").";
+    }
+}
+
+void Context::release() const
+{
+    if (!::eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE
+                          , EGL_NO_CONTEXT))
+    {
+        LOGTHROW(err1, Error)
+            << "EGL: Cannot release current context on display " << dpy_
+            << " (" << detail::error() << ").";
+    }
+}
+
+namespace {
+
+std::atomic<bool> debugContexts_(false);
+
+/** Adds debug flag to context attributes unless already present.
+ */
+std::vector< ::EGLint> debugAttributes(const Display &dpy
+                                       , const ::EGLint *attributes)
+{
+    int major(0), minor(0);
+    if (const auto *version = ::eglQueryString(dpy, EGL_VERSION)) {
+        std::sscanf(version, "%d.%d", &major, &minor);
+    }
+    const bool egl15((major > 1) || ((major == 1) && (minor >= 5)));
+
+    std::vector< ::EGLint> attrs;
+    bool done(false);
+    for (; attributes && (*attributes != EGL_NONE); attributes += 2) {
+        ::EGLint value(attributes[1]);
+        switch (attributes[0]) {
+        case EGL_CONTEXT_OPENGL_DEBUG:
+            done = true;
+            break;
+
+        case EGL_CONTEXT_FLAGS_KHR:
+            if (!egl15) {
+                value |= EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR;
+                done = true;
+            }
+            break;
+        }
+        attrs.push_back(attributes[0]);
+        attrs.push_back(value);
+    }
+
+    if (!done) {
+        if (egl15) {
+            attrs.push_back(EGL_CONTEXT_OPENGL_DEBUG);
+            attrs.push_back(EGL_TRUE);
+        } else if (dpy.hasExtension("EGL_KHR_create_context")) {
+            attrs.push_back(EGL_CONTEXT_FLAGS_KHR);
+            attrs.push_back(EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR);
+        } else {
+            LOG(warn2) << "EGL: Debug contexts not supported on display "
+                       << dpy << ".";
+        }
+    }
+
+    attrs.push_back(EGL_NONE);
+    return attrs;
+}
+
+} // namespace
+
+void debugContexts(bool enable)
+{
+    debugContexts_ = enable;
+}
+
+bool debugContexts()
+{
+    return debugContexts_;
+}
 
 namespace detail {
 
 Context context(const Display &dpy, ::EGLConfig config
                 , ::EGLContext share, const ::EGLint *attributes)
 {
+    std::vector< ::EGLint> debug;
+    if (debugContexts_) {
+        debug = debugAttributes(dpy, attributes);
+        attributes = debug.data();
+    }
+
     auto context(::eglCreateContext(dpy, config, share, attributes));
     if (context == EGL_NO_CONTEXT) {
         LOGTHROW(err2, Error)
@@ -326,6 +465,21 @@ Context context(const Display &dpy, ::EGLConfig config
     return Context(dpy, context);
 }
 
+bool hasExtension(const char *extensions, const std::string &name)
+{
+    if (!extensions || name.empty()) { return false; }
+
+    // space separated list
+    for (const char *p(extensions); (p = std::strstr(p, name.c_str()))
+             ; p += name.size())
+    {
+        const bool start((p == extensions) || (p[-1] == ' '));
+        const char end(p[name.size()]);
+        if (start && (!end || (end == ' '))) { return true; }
+    }
+    return false;
+}
+
 const char* error()
 {
     switch (eglGetError()) {
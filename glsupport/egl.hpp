@@ -46,9 +46,17 @@ namespace glsupport { namespace egl {
 namespace detail {
 const char* error();
 
+/** Checks presence of extension in space separated extension list.
+ */
+bool hasExtension(const char *extensions, const std::string &name);
+
 struct PlaceHolder { PlaceHolder() {}; };
 } // namespace detail
 
+/** Tag for surfaceless platform display.
+ */
+struct Surfaceless { Surfaceless() {} };
+
 struct Error : std::runtime_error {
     Error(const std::string &msg) : std::runtime_error(msg) {}
 };
@@ -66,12 +74,39 @@ struct Device {
     Device(::EGLDeviceEXT device) : device(device) {}
 
     operator bool() const { return device; }
+
+    /** Device extension string (EGL_EXT_device_query).
+     */
+    std::string extensions() const;
+
+    bool hasExtension(const std::string &name) const;
+
+    /** DRM device file (EGL_EXT_device_drm), empty if not available.
+     */
+    std::string drmDeviceFile() const;
+
+    /** DRM render node file (EGL_EXT_device_drm_render_node), empty if not
+     *  available.
+     */
+    std::string drmRenderNode() const;
+
+    /** Software renderer (EGL_MESA_device_software).
+     */
+    bool software() const;
+
+    /** Human readable identification: DRM node or "software".
+     */
+    std::string name() const;
 };
 
 /** Query for all available devices on the platform.
  */
 Device::list queryDevices();
 
+/** Checks for client (display independent) extension.
+ */
+bool hasClientExtension(const std::string &name);
+
 class Display {
 public:
     typedef std::shared_ptr<std::remove_pointer< ::EGLDisplay>::type> Ptr;
@@ -80,8 +115,18 @@ public:
 
     Display(const Device &device);
 
+    /** Opens display on surfaceless platform (EGL_MESA_platform_surfaceless).
+     *  Such display has no window system; use pbuffers or surfaceless
+     *  contexts.
+     */
+    Display(const Surfaceless&);
+
     Display(detail::PlaceHolder) {}
 
+    /** Checks for display extension.
+     */
+    bool hasExtension(const std::string &name) const;
+
     ::EGLDisplay operator*() const { return dpy_.get(); }
     operator ::EGLDisplay() const { return dpy_.get(); }
 
@@ -127,6 +172,10 @@ private:
     typedef std::shared_ptr<std::remove_pointer< ::EGLSurface>::type> Ptr;
 
 public:
+    /** No surface (EGL_NO_SURFACE).
+     */
+    Surface() {}
+
     Surface(const Display &dpy, ::EGLSurface surface);
 
     ::EGLSurface operator*() const { return surface_.get(); }
@@ -172,6 +221,16 @@ public:
     void makeCurrent(const Surface &surface) const;
     void makeCurrent(const Surface &draw, const Surface &read) const;
 
+    /** Makes context current without any surface. Requires
+     *  EGL_KHR_surfaceless_context; all rendering must go to framebuffer
+     *  objects.
+     */
+    void makeCurrent() const;
+
+    /** Releases current context (whichever it is) from calling thread.
+     */
+    void release() const;
+
     ::EGLContext operator*() const { return context_.get(); }
     operator ::EGLContext() const { return context_.get(); }
 
@@ -180,6 +239,15 @@ private:
     Ptr context_;
 };
 
+/** Process-wide switch: create all contexts (including ones created by
+ *  ContextPool and DeviceScheduler) as debug contexts
+ *  (EGL_CONTEXT_OPENGL_DEBUG or EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR). Explicit
+ *  debug attribute in context attributes takes precedence. Off by default.
+ */
+void debugContexts(bool enable);
+
+bool debugContexts();
+
 namespace detail {
 
 Context context(const Display &display, ::EGLConfig config
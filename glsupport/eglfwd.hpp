@@ -37,6 +37,8 @@ class Surface;
 
 class Context;
 
+class Image;
+
 } } // namespace glsupport::egl
 
 #endif // eglfwd_hpp_included_
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+
+#include "./eglimage.hpp"
+#include "./ext.hpp"
+
+namespace glsupport { namespace egl {
+
+namespace {
+
+struct Functions {
+    PFNEGLCREATEIMAGEKHRPROC createImage;
+    PFNEGLDESTROYIMAGEKHRPROC destroyImage;
+
+    Functions()
+        : createImage(ext::eglGetProcAddress<PFNEGLCREATEIMAGEKHRPROC>
+                      ("eglCreateImageKHR", std::nothrow))
+        , destroyImage(ext::eglGetProcAddress<PFNEGLDESTROYIMAGEKHRPROC>
+                       ("eglDestroyImageKHR", std::nothrow))
+    {}
+};
+
+const Functions& functions()
+{
+    static Functions functions;
+    return functions;
+}
+
+::EGLImageKHR createImage(const Display &dpy, ::EGLContext context
+                          , ::EGLenum target, ::EGLClientBuffer buffer
+                          , const ::EGLint *attributes)
+{
+    if (!Image::available(dpy)) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: EGL_KHR_image_base unavailable.";
+    }
+
+    auto image(functions().createImage(dpy, context, target, buffer
+                                       , attributes));
+    if (image == EGL_NO_IMAGE_KHR) {
+        LOGTHROW(err2, Error)
+            << "EGL: Cannot create image (" << detail::error() << ").";
+    }
+    return image;
+}
+
+} // namespace
+
+Image::Image(const Display &dpy, ::EGLImageKHR image)
+    : dpy_(dpy)
+{
+    // deleter holds display to keep it alive
+    image_.reset(image, [dpy](::EGLImageKHR image)
+    {
+        if (!functions().destroyImage(dpy, image)) {
+            LOG(warn2) << "EGL: Cannot destroy image ("
+                       << detail::error() << ").";
+        }
+    });
+}
+
+bool Image::available(const Display &dpy)
+{
+    const auto &f(functions());
+    return (f.createImage && f.destroyImage
+            && dpy.hasExtension("EGL_KHR_image_base"));
+}
+
+Image Image::fromTexture(const Display &dpy, const Context &context
+                         , ::GLuint texture, int level)
+{
+    if (!dpy.hasExtension("EGL_KHR_gl_texture_2D_image")) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: EGL_KHR_gl_texture_2D_image unavailable.";
+    }
+
+    const ::EGLint attributes[] = {
+        EGL_GL_TEXTURE_LEVEL_KHR, level
+        , EGL_NONE
+    };
+
+    return Image(dpy, createImage
+                 (dpy, context, EGL_GL_TEXTURE_2D_KHR
+                  , reinterpret_cast< ::EGLClientBuffer>
+                  (std::uintptr_t(texture))
+                  , attributes));
+}
+
+Image Image::create(const Display &dpy, ::EGLenum target
+                    , ::EGLClientBuffer buffer, const ::EGLint *attributes)
+{
+    return Image(dpy, createImage(dpy, EGL_NO_CONTEXT, target, buffer
+                                  , attributes));
+}
+
+} } // namespace glsupport::egl
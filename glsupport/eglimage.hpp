@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef eglimage_hpp_included_
+#define eglimage_hpp_included_
+
+#include <memory>
+
+#include "utility/gl.hpp"
+
+#include "./egl.hpp"
+
+namespace glsupport { namespace egl {
+
+/** EGLImage (EGL_KHR_image_base): client API independent handle to image
+ *  data shareable between contexts, client APIs and (via dma-buf, see
+ *  dmabuf.hpp) processes.
+ *
+ *  Shared handle; image is destroyed when last copy goes away. Sibling
+ *  objects created from the image (textures) keep the underlying data
+ *  alive on their own.
+ */
+class Image {
+public:
+    /** Creates empty (invalid) image.
+     */
+    Image() : dpy_(detail::PlaceHolder()) {}
+
+    /** Takes ownership of existing image.
+     */
+    Image(const Display &dpy, ::EGLImageKHR image);
+
+    /** Creates image from given level of GL 2D texture owned by given
+     *  context (EGL_KHR_gl_texture_2D_image). Texture must be complete.
+     */
+    static Image fromTexture(const Display &dpy, const Context &context
+                             , ::GLuint texture, int level = 0);
+
+    /** Creates image from given target (EGL_LINUX_DMA_BUF_EXT...) and
+     *  attributes without any context.
+     */
+    static Image create(const Display &dpy, ::EGLenum target
+                        , ::EGLClientBuffer buffer
+                        , const ::EGLint *attributes);
+
+    /** EGL_KHR_image_base is available on given display.
+     */
+    static bool available(const Display &dpy);
+
+    ::EGLImageKHR get() const { return image_.get(); }
+    ::EGLImageKHR operator*() const { return image_.get(); }
+
+    explicit operator bool() const { return bool(image_); }
+
+    /** Display the image belongs to.
+     */
+    const Display& display() const { return dpy_; }
+
+private:
+    Display dpy_;
+    std::shared_ptr<std::remove_pointer< ::EGLImageKHR>::type> image_;
+};
+
+} } // namespace glsupport::egl
+
+#endif // eglimage_hpp_included_
@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+
+#include "utility/gl.hpp"
+
+#include "./eglsync.hpp"
+#include "./ext.hpp"
+
+namespace glsupport { namespace egl {
+
+namespace {
+
+struct Functions {
+    PFNEGLCREATESYNCKHRPROC createSync;
+    PFNEGLDESTROYSYNCKHRPROC destroySync;
+    PFNEGLCLIENTWAITSYNCKHRPROC clientWaitSync;
+    PFNEGLWAITSYNCKHRPROC waitSync;
+
+    Functions()
+        : createSync(ext::eglGetProcAddress<PFNEGLCREATESYNCKHRPROC>
+                     ("eglCreateSyncKHR", std::nothrow))
+        , destroySync(ext::eglGetProcAddress<PFNEGLDESTROYSYNCKHRPROC>
+                      ("eglDestroySyncKHR", std::nothrow))
+        , clientWaitSync(ext::eglGetProcAddress<PFNEGLCLIENTWAITSYNCKHRPROC>
+                         ("eglClientWaitSyncKHR", std::nothrow))
+        , waitSync(ext::eglGetProcAddress<PFNEGLWAITSYNCKHRPROC>
+                   ("eglWaitSyncKHR", std::nothrow))
+    {}
+};
+
+const Functions& functions()
+{
+    static Functions functions;
+    return functions;
+}
+
+} // namespace
+
+struct Sync::Detail {
+    Display dpy;
+    ::EGLSyncKHR sync;
+
+    /** Context the fence was inserted in; only waiting in it flushes the
+     *  fence to the GPU.
+     */
+    ::EGLContext producer;
+    std::atomic<bool> flushed;
+
+    Detail(const Display &dpy, ::EGLSyncKHR sync, bool flushed)
+        : dpy(dpy), sync(sync), producer(::eglGetCurrentContext())
+        , flushed(flushed)
+    {}
+
+    ~Detail() { functions().destroySync(dpy, sync); }
+
+    /** Client wait, flushes command stream on first call in producer's
+     *  context.
+     */
+    bool wait(::EGLTimeKHR timeout, const char *what);
+};
+
+bool Sync::Detail::wait(::EGLTimeKHR timeout, const char *what)
+{
+    ::EGLint flags(0);
+    if (!flushed && (::eglGetCurrentContext() == producer)) {
+        flags = EGL_SYNC_FLUSH_COMMANDS_BIT_KHR;
+        flushed = true;
+    }
+
+    switch (functions().clientWaitSync(dpy, sync, flags, timeout)) {
+    case EGL_CONDITION_SATISFIED_KHR:
+        return true;
+
+    case EGL_TIMEOUT_EXPIRED_KHR:
+        return false;
+
+    default: break;
+    }
+
+    LOGTHROW(err2, Error)
+        << "EGL: Failed to " << what << " fence sync ("
+        << detail::error() << ").";
+    return false;
+}
+
+bool Sync::available(const Display &dpy)
+{
+    const auto &f(functions());
+    return (f.createSync && f.destroySync && f.clientWaitSync
+            && dpy.hasExtension("EGL_KHR_fence_sync"));
+}
+
+bool Sync::serverWaitAvailable(const Display &dpy)
+{
+    return (available(dpy) && functions().waitSync
+            && dpy.hasExtension("EGL_KHR_wait_sync"));
+}
+
+Sync Sync::fence(const Display &dpy, bool flush)
+{
+    if (!available(dpy)) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: EGL_KHR_fence_sync unavailable.";
+    }
+
+    auto sync(functions().createSync(dpy, EGL_SYNC_FENCE_KHR, nullptr));
+    if (sync == EGL_NO_SYNC_KHR) {
+        LOGTHROW(err2, Error)
+            << "EGL: Cannot create fence sync (" << detail::error() << ").";
+    }
+
+    if (flush) { ::glFlush(); }
+
+    Sync s;
+    s.detail_ = std::make_shared<Detail>(dpy, sync, flush);
+    return s;
+}
+
+bool Sync::signaled() const
+{
+    if (!detail_) { return true; }
+    return detail_->wait(0, "query");
+}
+
+bool Sync::wait(std::chrono::nanoseconds timeout) const
+{
+    if (!detail_) { return true; }
+    return detail_->wait(::EGLTimeKHR(timeout.count()), "wait for");
+}
+
+void Sync::wait() const
+{
+    if (!detail_) { return; }
+    detail_->wait(EGL_FOREVER_KHR, "wait for");
+}
+
+void Sync::serverWait() const
+{
+    if (!detail_) { return; }
+
+    const auto waitSync(functions().waitSync);
+    if (!waitSync) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: eglWaitSyncKHR unavailable.";
+    }
+
+    if (!waitSync(detail_->dpy, detail_->sync, 0)) {
+        LOGTHROW(err2, Error)
+            << "EGL: Cannot wait for fence sync on server ("
+            << detail::error() << ").";
+    }
+}
+
+::EGLSyncKHR Sync::get() const
+{
+    return detail_ ? detail_->sync : EGL_NO_SYNC_KHR;
+}
+
+} } // namespace glsupport::egl
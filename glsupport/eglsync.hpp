@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef eglsync_hpp_included_
+#define eglsync_hpp_included_
+
+#include <memory>
+#include <chrono>
+
+#include "./egl.hpp"
+
+namespace glsupport { namespace egl {
+
+/** EGL fence sync object (EGL_KHR_fence_sync).
+ *
+ *  Unlike GL fence (glsupport::Fence) EGL sync object is a display
+ *  object: it can be waited for from any thread and any context on the same
+ *  display, even from contexts outside fence's share group.
+ *
+ *  Shared handle; sync object is destroyed when last copy goes away.
+ */
+class Sync {
+public:
+    /** Creates empty (invalid) sync.
+     */
+    Sync() {}
+
+    /** Inserts new fence into command stream of context current in calling
+     *  thread (bound client API).
+     *
+     *  Fence inserted in one context and waited for in another context
+     *  must reach the GPU first; flush = true flushes producer's command
+     *  stream right away. Otherwise only waiting in the producer's context
+     *  flushes it: with flush = false the producer must flush (or wait
+     *  itself) before other contexts can rely on the fence.
+     */
+    static Sync fence(const Display &dpy, bool flush = true);
+
+    /** EGL_KHR_fence_sync is available on given display.
+     */
+    static bool available(const Display &dpy);
+
+    /** EGL_KHR_wait_sync (serverWait()) is available on given display.
+     */
+    static bool serverWaitAvailable(const Display &dpy);
+
+    /** Non-blocking check whether fence has been signaled. Empty sync is
+     *  always signaled.
+     */
+    bool signaled() const;
+
+    /** Blocks calling thread until fence is signaled or timeout expires.
+     *
+     * \return true if fence has been signaled, false on timeout
+     */
+    bool wait(std::chrono::nanoseconds timeout) const;
+
+    /** Blocks calling thread until fence is signaled.
+     */
+    void wait() const;
+
+    /** Makes context current in calling thread wait (on the GPU) until
+     *  fence is signaled. Returns immediately. No-op for empty sync.
+     *
+     *  Requires EGL_KHR_wait_sync.
+     */
+    void serverWait() const;
+
+    ::EGLSyncKHR get() const;
+
+    explicit operator bool() const { return bool(detail_); }
+
+private:
+    struct Detail;
+    std::shared_ptr<Detail> detail_;
+};
+
+} } // namespace glsupport::egl
+
+#endif // eglsync_hpp_included_
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ext_hpp_included_
+#define ext_hpp_included_
+
+#include <dlfcn.h>
+
+#include <new>
+
+#include "./egl.hpp"
+
+namespace glsupport { namespace egl { namespace ext {
+
+/** Extension function loading. Both EGL and GL (for context created via EGL)
+ *  extension functions can be obtained via eglGetProcAddress.
+ */
+
+template <typename Prototype>
+Prototype getProcAddress(const char *name, std::nothrow_t)
+{
+    ::dlerror();
+    auto proc(Prototype(::dlsym(RTLD_DEFAULT, name)));
+    if (auto error = ::dlerror()) {
+        LOG(warn2)
+            << "Unable to get address of EGL function: "
+            << name << ": " << error << ".";
+        return nullptr;
+    }
+    return Prototype(proc);
+}
+
+template <typename Prototype>
+Prototype getProcAddress(const char *name)
+{
+    ::dlerror();
+    auto proc(Prototype(::dlsym(RTLD_DEFAULT, name)));
+    if (auto error = ::dlerror()) {
+        LOGTHROW(err2, MissingExtension)
+            << "Unable to get address of EGL function "
+            << name << ": " << error << ".";
+    }
+    return Prototype(proc);
+}
+
+template <typename Prototype>
+Prototype eglGetProcAddress(const char *name)
+{
+    typedef void* (EGLAPIENTRYP EglGetProcAddress)(const char *procname);
+    static auto loader(getProcAddress<EglGetProcAddress>
+                       ("eglGetProcAddress", std::nothrow));
+
+    if (!loader) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: unable to query extensions.";
+    }
+
+    auto proc(Prototype(loader(name)));
+    if (!proc) {
+        LOGTHROW(err2, MissingExtension)
+            << "EGL: unable to get <" << name << "> extension.";
+    }
+
+    return proc;
+}
+
+template <typename Prototype>
+Prototype eglGetProcAddress(const char *name, std::nothrow_t)
+{
+    typedef void* (EGLAPIENTRYP EglGetProcAddress)(const char *procname);
+    static auto loader(getProcAddress<EglGetProcAddress>
+                       ("eglGetProcAddress", std::nothrow));
+
+    if (!loader) { return nullptr; }
+    return Prototype(loader(name));
+}
+
+} } } // namespace glsupport::egl::ext
+
+#endif // ext_hpp_included_
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <unordered_set>
+
+#include <EGL/egl.h>
+
+#include "utility/gl.hpp"
+
+#include "./extensions.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Extensions of EGL context last seen current in this thread.
+ */
+struct Extensions {
+    ::EGLDisplay display;
+    ::EGLContext context;
+    std::unordered_set<std::string> names;
+
+    Extensions() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+};
+
+thread_local Extensions extensions_;
+
+template <typename Op>
+void forEachExtension(const Op &op)
+{
+    ::GLint count(0);
+    ::glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (::GLint i(0); i < count; ++i) {
+        auto ext(reinterpret_cast<const char*>
+                 (::glGetStringi(GL_EXTENSIONS, i)));
+        if (ext && op(ext)) { return; }
+    }
+}
+
+} // namespace
+
+bool hasExtension(const std::string &name)
+{
+    const auto context(::eglGetCurrentContext());
+    if (context == EGL_NO_CONTEXT) {
+        // not an EGL context, nothing to key the cache with
+        bool found(false);
+        forEachExtension([&](const char *ext) {
+            return (found = (name == ext));
+        });
+        return found;
+    }
+
+    auto &cache(extensions_);
+    const auto display(::eglGetCurrentDisplay());
+    if ((cache.context != context) || (cache.display != display)) {
+        cache.display = display;
+        cache.context = context;
+        cache.names.clear();
+        forEachExtension([&](const char *ext) {
+            cache.names.insert(ext);
+            return false;
+        });
+    }
+
+    return cache.names.count(name);
+}
+
+} // namespace glsupport
@@ -24,13 +24,24 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdint>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
 #include "dbglog/dbglog.hpp"
 
 #include "./fb.hpp"
 #include "./glerror.hpp"
+#include "./debug.hpp"
+#include "./statecache.hpp"
 
 namespace glsupport {
 
+namespace detail {
+
+std::atomic<bool> checkGlEnabled(true);
+
 void checkGl(const char *name)
 {
     auto err(::glGetError());
@@ -56,6 +67,13 @@ void checkGl(const char *name)
     }
 }
 
+} // namespace detail
+
+void checkGl(bool enable)
+{
+    detail::checkGlEnabled = enable;
+}
+
 namespace {
 
 void checkGlFramebuffer()
@@ -74,17 +92,289 @@ void checkGlFramebuffer()
     }
 }
 
+/** Internal format + client format and type for mutable textures.
+ */
+struct Format {
+    ::GLenum internal;
+    ::GLenum format;
+    ::GLenum type;
+};
+
+Format depthFormat(FrameBuffer::Depth depth)
+{
+    typedef FrameBuffer::Depth Depth;
+    switch (depth) {
+    case Depth::none: break;
+    case Depth::depth24:
+        return { GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT };
+    case Depth::depth32:
+        return { GL_DEPTH_COMPONENT32, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT };
+    case Depth::depth32f:
+        return { GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT };
+    case Depth::depth24Stencil8:
+        return { GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL
+                , GL_UNSIGNED_INT_24_8 };
+    case Depth::depth32fStencil8:
+        return { GL_DEPTH32F_STENCIL8, GL_DEPTH_STENCIL
+                , GL_FLOAT_32_UNSIGNED_INT_24_8_REV };
+    }
+    return { GL_NONE, GL_NONE, GL_NONE };
+}
+
+::GLenum depthAttachment(FrameBuffer::Depth depth)
+{
+    typedef FrameBuffer::Depth Depth;
+    switch (depth) {
+    case Depth::depth24Stencil8: case Depth::depth32fStencil8:
+        return GL_DEPTH_STENCIL_ATTACHMENT;
+    default: break;
+    }
+    return GL_DEPTH_ATTACHMENT;
+}
+
+/** Creates attachment of given storage. Textures are created in active
+ *  texture unit. Multisampled attachment is created for samples > 1.
+ */
+::GLuint createAttachment(FrameBuffer::Storage storage, const Format &format
+                          , const math::Size2 &size, int samples)
+{
+    typedef FrameBuffer::Storage Storage;
+
+    ::GLuint id(0);
+    if (storage == Storage::renderbuffer) {
+        ::glGenRenderbuffers(1, &id);
+        ::glBindRenderbuffer(GL_RENDERBUFFER, id);
+        if (samples > 1) {
+            ::glRenderbufferStorageMultisample
+                  (GL_RENDERBUFFER, samples, format.internal
+                   , size.width, size.height);
+        } else {
+            ::glRenderbufferStorage(GL_RENDERBUFFER, format.internal
+                                    , size.width, size.height);
+        }
+        ::glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        return id;
+    }
+
+    ::glGenTextures(1, &id);
+
+    if (samples > 1) {
+        state::bindTexture(GL_TEXTURE_2D_MULTISAMPLE, id);
+        if (storage == Storage::immutableTexture) {
+            ::glTexStorage2DMultisample
+                  (GL_TEXTURE_2D_MULTISAMPLE, samples, format.internal
+                   , size.width, size.height, GL_TRUE);
+        } else {
+            ::glTexImage2DMultisample
+                  (GL_TEXTURE_2D_MULTISAMPLE, samples, format.internal
+                   , size.width, size.height, GL_TRUE);
+        }
+        // multisample textures have no sampler state
+        return id;
+    }
+
+    state::bindTexture(GL_TEXTURE_2D, id);
+
+    if (storage == Storage::immutableTexture) {
+        ::glTexStorage2D(GL_TEXTURE_2D, 1, format.internal
+                         , size.width, size.height);
+    } else {
+        ::glTexImage2D(GL_TEXTURE_2D, 0, format.internal
+                       , size.width, size.height
+                       , 0, format.format, format.type, nullptr);
+    }
+
+    // nearest filtering keeps integer textures complete
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    return id;
+}
+
+void attach(FrameBuffer::Storage storage, ::GLenum attachment, ::GLuint id
+            , int samples)
+{
+    if (storage == FrameBuffer::Storage::renderbuffer) {
+        ::glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment
+                                    , GL_RENDERBUFFER, id);
+    } else {
+        ::glFramebufferTexture2D(GL_FRAMEBUFFER, attachment
+                                 , ((samples > 1)
+                                    ? GL_TEXTURE_2D_MULTISAMPLE
+                                    : GL_TEXTURE_2D)
+                                 , id, 0);
+    }
+}
+
+void destroyAttachment(FrameBuffer::Storage storage, ::GLuint id)
+{
+    if (!id) { return; }
+
+    if (storage == FrameBuffer::Storage::renderbuffer) {
+        ::glDeleteRenderbuffers(1, &id);
+    } else {
+        state::deleteTextures(1, &id);
+    }
+}
+
+Format colorFormat(PixelType pixelType)
+{
+    return { internalFormat(pixelType), pixelFormat(pixelType)
+            , pixelComponentType(pixelType) };
+}
+
+/** Estimated size of one pixel in GPU memory; drivers usually pad
+ *  three-component formats to four.
+ */
+std::size_t gpuPixelSize(PixelType pixelType)
+{
+    switch (pixelType) {
+    case PixelType::rgb8: return 4;
+    case PixelType::rgb16f: return 8;
+    case PixelType::rgb32f: return 16;
+    default: break;
+    }
+    return pixelSize(pixelType);
+}
+
+::GLenum colorAttachment(std::size_t index)
+{
+    return ::GLenum(GL_COLOR_ATTACHMENT0 + index);
+}
+
+/** Enables all color attachments of currently bound framebuffer as draw
+ *  buffers.
+ */
+void drawBuffers(std::size_t count)
+{
+    std::vector< ::GLenum> buffers;
+    for (std::size_t i(0); i < count; ++i) {
+        buffers.push_back(colorAttachment(i));
+    }
+    ::glDrawBuffers(::GLsizei(buffers.size()), buffers.data());
+}
+
 } // namespace
 
+::GLenum pixelFormat(PixelType pixelType)
+{
+    switch (pixelType) {
+    case PixelType::r8: case PixelType::r16f: case PixelType::r32f:
+        return GL_RED;
+    case PixelType::rg8: case PixelType::rg16f: case PixelType::rg32f:
+        return GL_RG;
+    case PixelType::rgb8: case PixelType::rgb16f: case PixelType::rgb32f:
+    case PixelType::r11g11b10f:
+        return GL_RGB;
+    case PixelType::rgba8: case PixelType::rgba16f: case PixelType::rgba32f:
+        return GL_RGBA;
+    case PixelType::r32ui:
+        return GL_RED_INTEGER;
+    }
+    return GL_RGB;
+}
+
+::GLenum pixelComponentType(PixelType pixelType)
+{
+    switch (pixelType) {
+    case PixelType::rgb8: case PixelType::rgba8:
+    case PixelType::r8: case PixelType::rg8:
+        return GL_UNSIGNED_BYTE;
+    case PixelType::r16f: case PixelType::rg16f:
+    case PixelType::rgb16f: case PixelType::rgba16f:
+        return GL_HALF_FLOAT;
+    case PixelType::rgb32f: case PixelType::rgba32f:
+    case PixelType::r32f: case PixelType::rg32f:
+        return GL_FLOAT;
+    case PixelType::r32ui:
+        return GL_UNSIGNED_INT;
+    case PixelType::r11g11b10f:
+        return GL_UNSIGNED_INT_10F_11F_11F_REV;
+    }
+    return GL_UNSIGNED_BYTE;
+}
+
+std::size_t pixelSize(PixelType pixelType)
+{
+    switch (pixelType) {
+    case PixelType::rgb8: return 3;
+    case PixelType::rgba8: return 4;
+    case PixelType::rgb32f: return 3 * sizeof(float);
+    case PixelType::rgba32f: return 4 * sizeof(float);
+    case PixelType::r8: return 1;
+    case PixelType::rg8: return 2;
+    case PixelType::r16f: return 2;
+    case PixelType::rg16f: return 2 * 2;
+    case PixelType::rgb16f: return 3 * 2;
+    case PixelType::rgba16f: return 4 * 2;
+    case PixelType::r32f: return sizeof(float);
+    case PixelType::rg32f: return 2 * sizeof(float);
+    case PixelType::r32ui: return sizeof(std::uint32_t);
+    case PixelType::r11g11b10f: return sizeof(std::uint32_t);
+    }
+    return 0;
+}
+
+::GLenum internalFormat(PixelType pixelType)
+{
+    switch (pixelType) {
+    case PixelType::rgb8: return GL_RGB8;
+    case PixelType::rgba8: return GL_RGBA8;
+    case PixelType::rgb32f: return GL_RGB32F;
+    case PixelType::rgba32f: return GL_RGBA32F;
+    case PixelType::r8: return GL_R8;
+    case PixelType::rg8: return GL_RG8;
+    case PixelType::r16f: return GL_R16F;
+    case PixelType::rg16f: return GL_RG16F;
+    case PixelType::rgb16f: return GL_RGB16F;
+    case PixelType::rgba16f: return GL_RGBA16F;
+    case PixelType::r32f: return GL_R32F;
+    case PixelType::rg32f: return GL_RG32F;
+    case PixelType::r32ui: return GL_R32UI;
+    case PixelType::r11g11b10f: return GL_R11F_G11F_B10F;
+    }
+    return GL_RGB8;
+}
+
+bool integerPixelType(PixelType pixelType)
+{
+    return pixelType == PixelType::r32ui;
+}
+
+bool FrameBuffer::Params::operator<(const Params &o) const
+{
+    return (std::tie(size.width, size.height, pixelType, extraColors
+                     , colorStorage, depth, depthStorage, samples)
+            < std::tie(o.size.width, o.size.height, o.pixelType
+                       , o.extraColors, o.colorStorage, o.depth
+                       , o.depthStorage, o.samples));
+}
+
+bool FrameBuffer::Params::operator==(const Params &o) const
+{
+    return (std::tie(size.width, size.height, pixelType, extraColors
+                     , colorStorage, depth, depthStorage, samples)
+            == std::tie(o.size.width, o.size.height, o.pixelType
+                        , o.extraColors, o.colorStorage, o.depth
+                        , o.depthStorage, o.samples));
+}
+
+FrameBuffer::FrameBuffer(const Params &params)
+    : params_(params)
+    , fbId_(), depthId_(), resolveFbId_()
+{
+    init();
+}
+
 FrameBuffer::FrameBuffer(const math::Size2 &size, bool alpha)
-    : size_(size), pixelType_(alpha ? PixelType::rgba8 : PixelType::rgb8)
-    , fbId_(), depthTextureId_(), colorTextureId_()
+    : params_(size, alpha ? PixelType::rgba8 : PixelType::rgb8)
+    , fbId_(), depthId_(), resolveFbId_()
 {
     init();
 }
+
 FrameBuffer::FrameBuffer(const math::Size2 &size, PixelType pixelType)
-    : size_(size), pixelType_(pixelType)
-    , fbId_(), depthTextureId_(), colorTextureId_()
+    : params_(size, pixelType)
+    , fbId_(), depthId_(), resolveFbId_()
 {
     init();
 }
@@ -93,71 +383,193 @@ void FrameBuffer::init()
 {
     checkGl("pre-framebuffer check");
 
-    // depth buffer
-    ::glActiveTexture(GL_TEXTURE0 + 5);
-    ::glGenTextures(1, &depthTextureId_);
-    ::glBindTexture(GL_TEXTURE_2D, depthTextureId_);
+    // attachments are created in whatever texture unit is active
+    StateGuard guard;
+    guard.texture(GL_TEXTURE_2D).texture(GL_TEXTURE_2D_MULTISAMPLE);
 
-    ::glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32,
-                   size_.width, size_.height,
-                   0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
-    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    const auto samples(params_.samples);
 
-    checkGl("update depth texture");
+    // depth buffer
+    if (params_.depth != Depth::none) {
+        const auto format(depthFormat(params_.depth));
+        depthId_ = createAttachment(params_.depthStorage, format
+                                    , params_.size, samples);
+        checkGl("update depth attachment");
+    }
 
-    // color buffer
-    ::glActiveTexture(GL_TEXTURE0 + 7);
-    ::glGenTextures(1, &colorTextureId_);
-    ::glBindTexture(GL_TEXTURE_2D, colorTextureId_);
+    // color buffers
+    const auto colorCount(params_.colorCount());
+    for (std::size_t i(0); i < colorCount; ++i) {
+        colorIds_.push_back
+            (createAttachment(params_.colorStorage
+                              , colorFormat(params_.color(i))
+                              , params_.size, samples));
+        checkGl("update color attachment");
+    }
 
-    switch (pixelType_) {
-    case PixelType::rgb8:
-        ::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8,
-                       size_.width, size_.height,
-                       0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-        break;
+    ::glGenFramebuffers(1, &fbId_);
+    state::bindFramebuffer(GL_FRAMEBUFFER, fbId_);
 
-    case PixelType::rgba8:
-        ::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-                       size_.width, size_.height,
-                       0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-        break;
+    if (depthId_) {
+        attach(params_.depthStorage, depthAttachment(params_.depth)
+               , depthId_, samples);
+    }
+    for (std::size_t i(0); i < colorCount; ++i) {
+        attach(params_.colorStorage, colorAttachment(i), colorIds_[i]
+               , samples);
+    }
+    drawBuffers(colorCount);
 
-    case PixelType::rgb32f:
-        ::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F,
-                       size_.width, size_.height,
-                       0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-        break;
+    checkGlFramebuffer();
+    checkGl("update frame buffer");
 
-    case PixelType::rgba32f:
-        ::glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
-                       size_.width, size_.height,
-                       0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-        break;
+    if (samples > 1) {
+        initResolve();
+        state::bindFramebuffer(GL_FRAMEBUFFER, fbId_);
     }
 
-    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    if (objectLabels()) {
+        std::ostringstream os;
+        os << "framebuffer " << params_.size;
+        if (samples > 1) { os << " x" << samples; }
+        label(os.str());
+    }
+}
 
-    checkGl("update color texture");
+void FrameBuffer::initResolve()
+{
+    // single-sample resolve target, color only
+    const auto colorCount(params_.colorCount());
+    for (std::size_t i(0); i < colorCount; ++i) {
+        resolveColorIds_.push_back
+            (createAttachment(params_.colorStorage
+                              , colorFormat(params_.color(i))
+                              , params_.size, 1));
+        checkGl("update resolve color attachment");
+    }
 
-    ::glGenFramebuffers(1, &fbId_);
-    ::glBindFramebuffer(GL_FRAMEBUFFER, fbId_);
-    ::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT
-                             , GL_TEXTURE_2D, depthTextureId_, 0);
-    ::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0
-                             , GL_TEXTURE_2D, colorTextureId_, 0);
+    ::glGenFramebuffers(1, &resolveFbId_);
+    state::bindFramebuffer(GL_FRAMEBUFFER, resolveFbId_);
+    for (std::size_t i(0); i < colorCount; ++i) {
+        attach(params_.colorStorage, colorAttachment(i), resolveColorIds_[i]
+               , 1);
+    }
+    drawBuffers(colorCount);
 
     checkGlFramebuffer();
-    checkGl("update frame buffer");
+    checkGl("update resolve frame buffer");
+}
+
+void FrameBuffer::label(const std::string &name) const
+{
+    if (!objectLabels()) { return; }
+
+    const auto attachment([&](Storage storage) {
+        return ((storage == Storage::renderbuffer)
+                ? GL_RENDERBUFFER : GL_TEXTURE);
+    });
+
+    objectLabel(GL_FRAMEBUFFER, fbId_, name);
+    objectLabel(attachment(params_.depthStorage), depthId_, name + ".depth");
+    for (std::size_t i(0); i < colorIds_.size(); ++i) {
+        objectLabel(attachment(params_.colorStorage), colorIds_[i]
+                    , name + ".color" + std::to_string(i));
+    }
+
+    if (!resolveFbId_) { return; }
+    objectLabel(GL_FRAMEBUFFER, resolveFbId_, name + ".resolve");
+    for (std::size_t i(0); i < resolveColorIds_.size(); ++i) {
+        objectLabel(attachment(params_.colorStorage), resolveColorIds_[i]
+                    , name + ".resolve.color" + std::to_string(i));
+    }
 }
 
 FrameBuffer::~FrameBuffer()
 {
-    ::glDeleteFramebuffers(1, &fbId_);
-    ::glDeleteTextures(1, &depthTextureId_);
-    ::glDeleteTextures(1, &colorTextureId_);
+    state::deleteFramebuffers(1, &fbId_);
+    destroyAttachment(params_.depthStorage, depthId_);
+    for (auto id : colorIds_) {
+        destroyAttachment(params_.colorStorage, id);
+    }
+
+    if (resolveFbId_) {
+        state::deleteFramebuffers(1, &resolveFbId_);
+        for (auto id : resolveColorIds_) {
+            destroyAttachment(params_.colorStorage, id);
+        }
+    }
+}
+
+void FrameBuffer::bind() const
+{
+    state::bindFramebuffer(GL_FRAMEBUFFER, fbId_);
+}
+
+void FrameBuffer::resolve() const
+{
+    if (!resolveFbId_) { return; }
+
+    StateGuard guard;
+    guard.framebuffers();
+
+    state::bindFramebuffer(GL_READ_FRAMEBUFFER, fbId_);
+    state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFbId_);
+
+    // blit resolves only read buffer -> draw buffers, one attachment at a
+    // time
+    const auto colorCount(colorIds_.size());
+    for (std::size_t i(0); i < colorCount; ++i) {
+        const auto attachment(colorAttachment(i));
+        ::glReadBuffer(attachment);
+        ::glDrawBuffers(1, &attachment);
+        ::glBlitFramebuffer(0, 0, params_.size.width, params_.size.height
+                            , 0, 0, params_.size.width, params_.size.height
+                            , GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    if (colorCount > 1) {
+        ::glReadBuffer(GL_COLOR_ATTACHMENT0);
+        drawBuffers(colorCount);
+    }
+
+    checkGl("resolve frame buffer");
+}
+
+std::size_t FrameBuffer::byteSize(std::size_t index) const
+{
+    return (std::size_t(params_.size.width) * params_.size.height
+            * pixelSize(params_.color(index)));
+}
+
+std::size_t FrameBuffer::memory() const
+{
+    return memory(params_);
+}
+
+std::size_t FrameBuffer::memory(const Params &params)
+{
+    // depth + all colors
+    std::size_t depth(0);
+    switch (params.depth) {
+    case Depth::none: break;
+    case Depth::depth24: case Depth::depth32: case Depth::depth32f:
+    case Depth::depth24Stencil8:
+        depth = 4; break;
+    case Depth::depth32fStencil8: depth = 8; break;
+    }
+
+    std::size_t color(0);
+    for (std::size_t i(0), e(params.colorCount()); i < e; ++i) {
+        color += gpuPixelSize(params.color(i));
+    }
+
+    auto pixel(color + depth);
+    if (params.samples > 1) {
+        // multisampled attachments + single-sample resolve target
+        pixel = pixel * params.samples + color;
+    }
+
+    return std::size_t(params.size.width) * params.size.height * pixel;
 }
 
 } // namespace glsupport
@@ -28,6 +28,8 @@
 #define fb_hpp_included_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "utility/gl.hpp"
 
@@ -37,10 +39,123 @@ namespace glsupport {
 
 enum PixelType {
     rgb8, rgba8, rgb32f, rgba32f
+    // single and two channel
+    , r8, rg8, r16f, rg16f, r32f, rg32f
+    // half float
+    , rgb16f, rgba16f
+    // unsigned integer (object IDs etc.), not filterable nor blendable
+    , r32ui
+    // packed float without sign and alpha
+    , r11g11b10f
 };
 
+/** Client-side pixel format (GL_RGB, GL_RGBA...) of given pixel type.
+ */
+::GLenum pixelFormat(PixelType pixelType);
+
+/** Client-side component type (GL_UNSIGNED_BYTE, GL_FLOAT...) of given pixel
+ *  type.
+ */
+::GLenum pixelComponentType(PixelType pixelType);
+
+/** Size of one pixel of given type in client memory.
+ */
+std::size_t pixelSize(PixelType pixelType);
+
+/** GPU-side (internal) format of given pixel type.
+ */
+::GLenum internalFormat(PixelType pixelType);
+
+/** Is given pixel type an integer format? Integer attachments must be
+ *  cleared by glClearBufferuiv and read by *_INTEGER client formats.
+ */
+bool integerPixelType(PixelType pixelType);
+
 class FrameBuffer {
 public:
+    /** Attachment storage.
+     */
+    enum class Storage {
+        /** Mutable texture (glTexImage2D).
+         */
+        texture
+        /** Immutable texture (glTexStorage2D).
+         */
+        , immutableTexture
+        /** Renderbuffer, cannot be sampled.
+         */
+        , renderbuffer
+    };
+
+    /** Depth (and stencil) attachment format.
+     */
+    enum class Depth {
+        none, depth24, depth32, depth32f, depth24Stencil8, depth32fStencil8
+    };
+
+    /** Framebuffer parameters. Framebuffers with equal parameters are
+     *  interchangeable.
+     *
+     *  Defaults: single mutable color texture, mutable 32 bit depth texture,
+     *  single sample.
+     */
+    struct Params {
+        math::Size2 size;
+
+        /** Format of color attachment 0.
+         */
+        PixelType pixelType;
+
+        /** Formats of additional color attachments (GL_COLOR_ATTACHMENT1
+         *  onwards). All color attachments share colorStorage and all are
+         *  enabled as draw buffers in attachment order.
+         */
+        std::vector<PixelType> extraColors;
+
+        Storage colorStorage;
+        Depth depth;
+        Storage depthStorage;
+
+        /** Number of samples per pixel, values > 1 enable multisampling.
+         *  Multisampled color is resolved into single-sample target by
+         *  resolve().
+         */
+        int samples;
+
+        Params(const math::Size2 &size
+               , PixelType pixelType = PixelType::rgb8)
+            : size(size), pixelType(pixelType)
+            , colorStorage(Storage::texture)
+            , depth(Depth::depth32), depthStorage(Storage::texture)
+            , samples(1)
+        {}
+
+        /** Adds another color attachment.
+         */
+        Params& addColor(PixelType pixelType) {
+            extraColors.push_back(pixelType);
+            return *this;
+        }
+
+        /** Number of color attachments.
+         */
+        std::size_t colorCount() const { return 1 + extraColors.size(); }
+
+        /** Format of given color attachment.
+         */
+        PixelType color(std::size_t index) const {
+            return index ? extraColors[index - 1] : pixelType;
+        }
+
+        bool operator<(const Params &o) const;
+        bool operator==(const Params &o) const;
+    };
+
+    /** Creates framebuffer and leaves it bound. Active texture unit and its
+     *  texture bindings are left untouched.
+     */
+    FrameBuffer(const Params &params);
+
     /** Preferred version.
      */
     FrameBuffer(const math::Size2 &size
@@ -52,17 +167,132 @@ public:
 
     ~FrameBuffer();
 
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    /** Binds this framebuffer to GL_FRAMEBUFFER target.
+     */
+    void bind() const;
+
+    /** Labels framebuffer and its attachments (<name>.color0, <name>.depth,
+     *  ...) for GL debug output and debuggers, see objectLabel(). New
+     *  framebuffer is labeled by its parameters.
+     */
+    void label(const std::string &name) const;
+
+    /** Resolves all multisampled color attachments into single-sample
+     *  target (via glBlitFramebuffer). No-op for single-sample framebuffer.
+     */
+    void resolve() const;
+
+    /** Is this framebuffer multisampled?
+     */
+    bool multisampled() const { return params_.samples > 1; }
+
+    /** Framebuffer to read resolved color from: resolve target for
+     *  multisampled framebuffer, this framebuffer otherwise.
+     */
+    ::GLuint readId() const { return resolveFbId_ ? resolveFbId_ : fbId_; }
+
+    const Params& params() const { return params_; }
+    const math::Size2& size() const { return params_.size; }
+
+    /** Format of given color attachment.
+     */
+    PixelType pixelType(std::size_t index = 0) const {
+        return params_.color(index);
+    }
+
+    /** Number of color attachments.
+     */
+    std::size_t colorCount() const { return colorIds_.size(); }
+
+    ::GLuint id() const { return fbId_; }
+
+    /** Depth texture, 0 when depth is not a texture.
+     */
+    ::GLuint depthTexture() const;
+
+    /** Depth renderbuffer, 0 when depth is not a renderbuffer.
+     */
+    ::GLuint depthRenderbuffer() const;
+
+    /** Texture of given color attachment, 0 when color is not a texture or
+     *  there is no such attachment.
+     */
+    ::GLuint colorTexture(std::size_t index = 0) const;
+
+    /** Renderbuffer of given color attachment, 0 when color is not a
+     *  renderbuffer or there is no such attachment.
+     */
+    ::GLuint colorRenderbuffer(std::size_t index = 0) const;
+
+    /** Single-sample texture with resolved content of given color
+     *  attachment; same as colorTexture() for single-sample
+     *  framebuffer. Multisampled content must be resolved first.
+     */
+    ::GLuint resolvedColorTexture(std::size_t index = 0) const;
+
+    /** Size of given color attachment content in client memory.
+     */
+    std::size_t byteSize(std::size_t index = 0) const;
+
+    /** Estimated memory occupied by all attachments.
+     */
+    std::size_t memory() const;
+
+    /** Estimated memory of framebuffer with given parameters, known before
+     *  it is created.
+     */
+    static std::size_t memory(const Params &params);
+
 private:
     void init();
+    void initResolve();
 
-    const math::Size2 size_;
-    PixelType pixelType_;
+    const Params params_;
 
     ::GLuint fbId_;
-    ::GLuint depthTextureId_;
-    ::GLuint colorTextureId_;
+    ::GLuint depthId_;
+    std::vector< ::GLuint> colorIds_;
+
+    // multisample resolve target
+    ::GLuint resolveFbId_;
+    std::vector< ::GLuint> resolveColorIds_;
 };
 
+// inlines
+
+inline ::GLuint FrameBuffer::depthTexture() const
+{
+    return (params_.depthStorage == Storage::renderbuffer) ? 0 : depthId_;
+}
+
+inline ::GLuint FrameBuffer::depthRenderbuffer() const
+{
+    return (params_.depthStorage == Storage::renderbuffer) ? depthId_ : 0;
+}
+
+inline ::GLuint FrameBuffer::colorTexture(std::size_t index) const
+{
+    if (params_.colorStorage == Storage::renderbuffer) { return 0; }
+    return (index < colorIds_.size()) ? colorIds_[index] : 0;
+}
+
+inline ::GLuint FrameBuffer::colorRenderbuffer(std::size_t index) const
+{
+    if (params_.colorStorage != Storage::renderbuffer) { return 0; }
+    return (index < colorIds_.size()) ? colorIds_[index] : 0;
+}
+
+inline ::GLuint FrameBuffer::resolvedColorTexture(std::size_t index) const
+{
+    if (!resolveFbId_) { return colorTexture(index); }
+    if (params_.colorStorage == Storage::renderbuffer) { return 0; }
+    return ((index < resolveColorIds_.size())
+            ? resolveColorIds_[index] : 0);
+}
+
 } // namespace glsupport
 
 #endif // fb_hpp_included_
@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <list>
+#include <map>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./fbpool.hpp"
+
+namespace glsupport {
+
+struct FrameBufferPool::Detail
+    : std::enable_shared_from_this<FrameBufferPool::Detail>
+{
+    typedef std::unique_ptr<FrameBuffer> Owned;
+
+    /** Idle framebuffers, least recently used first.
+     */
+    typedef std::list<Owned> Lru;
+
+    /** Index of idle framebuffers by parameters.
+     */
+    typedef std::multimap<FrameBuffer::Params, Lru::iterator> Index;
+
+    std::size_t memoryLimit;
+    Lru lru;
+    Index index;
+    Stats stats;
+
+    Detail(std::size_t memoryLimit) : memoryLimit(memoryLimit) {}
+
+    Handle acquire(const FrameBuffer::Params &params);
+
+    void release(FrameBuffer *fb);
+
+    /** Evicts idle framebuffers until memory fits into the limit.
+     */
+    void evict(std::size_t limit);
+
+    Handle handle(Owned fb);
+};
+
+FrameBufferPool::Handle FrameBufferPool::Detail::handle(Owned fb)
+{
+    std::weak_ptr<Detail> pool(shared_from_this());
+    return Handle(fb.release(), [pool](FrameBuffer *fb)
+    {
+        if (auto detail = pool.lock()) {
+            detail->release(fb);
+        } else {
+            // pool is gone
+            delete fb;
+        }
+    });
+}
+
+FrameBufferPool::Handle
+FrameBufferPool::Detail::acquire(const FrameBuffer::Params &params)
+{
+    auto found(index.find(params));
+    if (found != index.end()) {
+        auto fb(std::move(*found->second));
+        lru.erase(found->second);
+        index.erase(found);
+        ++stats.hits;
+        --stats.idle;
+        return handle(std::move(fb));
+    }
+
+    ++stats.misses;
+    // make room for new framebuffer before allocating it
+    const auto memory(FrameBuffer::memory(params));
+    evict((memory < memoryLimit) ? memoryLimit - memory : 0);
+
+    Owned fb(new FrameBuffer(params));
+    stats.memory += memory;
+    return handle(std::move(fb));
+}
+
+void FrameBufferPool::Detail::release(FrameBuffer *fb)
+{
+    Owned owned(fb);
+    const auto params(owned->params());
+
+    lru.push_back(std::move(owned));
+    index.insert(Index::value_type(params, std::prev(lru.end())));
+    ++stats.idle;
+
+    evict(memoryLimit);
+}
+
+void FrameBufferPool::Detail::evict(std::size_t limit)
+{
+    while ((stats.memory > limit) && !lru.empty()) {
+        auto &fb(lru.front());
+
+        // remove from index
+        auto range(index.equal_range(fb->params()));
+        for (; range.first != range.second; ++range.first) {
+            if (range.first->second == lru.begin()) {
+                index.erase(range.first);
+                break;
+            }
+        }
+
+        stats.memory -= fb->memory();
+        ++stats.evictions;
+        --stats.idle;
+        lru.pop_front();
+    }
+}
+
+FrameBufferPool::FrameBufferPool(std::size_t memoryLimit)
+    : detail_(std::make_shared<Detail>(memoryLimit))
+{}
+
+FrameBufferPool::~FrameBufferPool() {}
+
+FrameBufferPool::Handle
+FrameBufferPool::acquire(const FrameBuffer::Params &params)
+{
+    return detail_->acquire(params);
+}
+
+void FrameBufferPool::trim()
+{
+    detail_->evict(0);
+}
+
+FrameBufferPool::Stats FrameBufferPool::stats() const
+{
+    return detail_->stats;
+}
+
+} // namespace glsupport
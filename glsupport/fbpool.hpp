@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef fbpool_hpp_included_
+#define fbpool_hpp_included_
+
+#include <memory>
+
+#include "./fb.hpp"
+
+namespace glsupport {
+
+/** Pool of recyclable framebuffers.
+ *
+ *  Framebuffers are keyed by their parameters (FrameBuffer::Params).
+ *  Acquired framebuffer is returned to the pool when the last handle goes
+ *  away; next acquisition with the same parameters reuses it instead of
+ *  allocating new GL objects. Content of recycled framebuffer is undefined.
+ *
+ *  Idle framebuffers are evicted in LRU order to keep memory occupied by all
+ *  framebuffers (both in use and idle) under given limit. Framebuffers in
+ *  use are never evicted, therefore the limit can be exceeded temporarily.
+ *
+ *  Framebuffer objects cannot be shared between GL contexts; the pool
+ *  belongs to the context it is used in and must not be used from multiple
+ *  threads. Handles can outlive the pool.
+ */
+class FrameBufferPool {
+public:
+    typedef std::shared_ptr<FrameBuffer> Handle;
+
+    struct Stats {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t evictions;
+
+        /** Number of idle framebuffers.
+         */
+        std::size_t idle;
+
+        /** Estimated memory of all framebuffers (in use and idle).
+         */
+        std::size_t memory;
+
+        Stats() : hits(), misses(), evictions(), idle(), memory() {}
+    };
+
+    /** Creates pool.
+     *
+     * \param memoryLimit upper memory bound in bytes
+     */
+    FrameBufferPool(std::size_t memoryLimit);
+
+    ~FrameBufferPool();
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    /** Acquires framebuffer with given parameters.
+     */
+    Handle acquire(const FrameBuffer::Params &params);
+
+    Handle acquire(const math::Size2 &size
+                   , PixelType pixelType = PixelType::rgb8);
+
+    /** Destroys all idle framebuffers.
+     */
+    void trim();
+
+    Stats stats() const;
+
+private:
+    struct Detail;
+    std::shared_ptr<Detail> detail_;
+};
+
+// inlines
+
+inline FrameBufferPool::Handle
+FrameBufferPool::acquire(const math::Size2 &size, PixelType pixelType)
+{
+    return acquire(FrameBuffer::Params(size, pixelType));
+}
+
+} // namespace glsupport
+
+#endif // fbpool_hpp_included_
@@ -27,10 +27,45 @@
 #ifndef glerror_hpp_included_
 #define glerror_hpp_included_
 
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
 namespace glsupport {
 
+struct Error : std::runtime_error {
+    Error(const std::string &msg) : std::runtime_error(msg) {}
+};
+
+namespace detail {
+
+extern std::atomic<bool> checkGlEnabled;
+
 void checkGl(const char *name);
 
+} // namespace detail
+
+/** Checks for pending GL error (glGetError) and throws when there is any.
+ *
+ *  glGetError synchronizes with the driver; the check can be turned off at
+ *  runtime by checkGl(false) (e.g. when debug output is used instead) or at
+ *  compile time by defining GLSUPPORT_DISABLE_CHECKGL.
+ */
+inline void checkGl(const char *name)
+{
+#ifndef GLSUPPORT_DISABLE_CHECKGL
+    if (detail::checkGlEnabled.load(std::memory_order_relaxed)) {
+        detail::checkGl(name);
+    }
+#else
+    (void) name;
+#endif
+}
+
+/** Enables/disables checkGl(const char*) at runtime. Enabled by default.
+ */
+void checkGl(bool enable);
+
 } // namespace glsupport
 
 #endif // glerror_hpp_included_
@@ -0,0 +1,275 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./gputimer.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+struct Label {
+    std::size_t count;
+    double min;
+    double max;
+    double sum;
+
+    /** Ring of latest samples.
+     */
+    std::vector<double> window;
+    std::size_t next;
+
+    Label()
+        : count(), min(std::numeric_limits<double>::max()), max(), sum()
+        , next()
+    {}
+
+    void add(double value, std::size_t windowSize) {
+        ++count;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+
+        if (window.size() < windowSize) {
+            window.push_back(value);
+        } else {
+            window[next] = value;
+            next = (next + 1) % windowSize;
+        }
+    }
+
+    GpuTimer::Stats stats() const {
+        GpuTimer::Stats s;
+        if (!count) { return s; }
+
+        s.count = count;
+        s.min = min;
+        s.max = max;
+        s.mean = sum / count;
+
+        auto sorted(window);
+        const auto rank(std::size_t(std::ceil(0.99 * sorted.size())) - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + rank
+                         , sorted.end());
+        s.p99 = sorted[rank];
+        return s;
+    }
+};
+
+void jsonString(std::ostream &os, const std::string &value)
+{
+    os << '"';
+    for (char c : value) {
+        switch (c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                   << int(c) << std::dec << std::setfill(' ');
+            } else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+} // namespace
+
+struct GpuTimer::Detail {
+    struct Range {
+        Label *label;
+        ::GLuint begin;
+        ::GLuint end;
+        bool ended;
+    };
+
+    const std::size_t window;
+    std::map<std::string, Label> labels;
+
+    /** Pending ranges in begin order; front has id `first`.
+     */
+    std::deque<Range> ranges;
+    std::size_t first;
+
+    std::vector< ::GLuint> free;
+
+    Detail(std::size_t window) : window(window ? window : 1), first() {}
+
+    ~Detail() {
+        for (const auto &range : ranges) {
+            ::glDeleteQueries(1, &range.begin);
+            if (range.ended) { ::glDeleteQueries(1, &range.end); }
+        }
+        if (!free.empty()) {
+            ::glDeleteQueries(::GLsizei(free.size()), free.data());
+        }
+    }
+
+    ::GLuint timestamp() {
+        ::GLuint query(0);
+        if (free.empty()) {
+            ::glGenQueries(1, &query);
+        } else {
+            query = free.back();
+            free.pop_back();
+        }
+        ::glQueryCounter(query, GL_TIMESTAMP);
+        return query;
+    }
+
+    std::size_t begin(const std::string &label) {
+        ranges.push_back({ &labels[label], timestamp(), 0, false });
+        return first + ranges.size() - 1;
+    }
+
+    void end(std::size_t id) {
+        auto &range(ranges[id - first]);
+        range.end = timestamp();
+        range.ended = true;
+    }
+
+    std::size_t collect() {
+        std::size_t collected(0);
+        while (!ranges.empty()) {
+            auto &range(ranges.front());
+            if (!range.ended) { break; }
+
+            // queries complete in order: end available -> begin available
+            ::GLint available(GL_FALSE);
+            ::glGetQueryObjectiv(range.end, GL_QUERY_RESULT_AVAILABLE
+                                 , &available);
+            if (!available) { break; }
+
+            ::GLuint64 begin(0), end(0);
+            ::glGetQueryObjectui64v(range.begin, GL_QUERY_RESULT, &begin);
+            ::glGetQueryObjectui64v(range.end, GL_QUERY_RESULT, &end);
+            range.label->add(double(end - begin), window);
+
+            free.push_back(range.begin);
+            free.push_back(range.end);
+            ranges.pop_front();
+            ++first;
+            ++collected;
+        }
+
+        checkGl("gpu timer collect");
+        return collected;
+    }
+};
+
+GpuTimer::GpuTimer(std::size_t window)
+    : detail_(new Detail(window))
+{}
+
+GpuTimer::~GpuTimer() {}
+
+GpuTimer::Scope GpuTimer::scope(const std::string &label)
+{
+    return Scope(detail_.get(), detail_->begin(label));
+}
+
+void GpuTimer::Scope::end()
+{
+    if (!detail_) { return; }
+    detail_->end(range_);
+    detail_ = nullptr;
+}
+
+std::size_t GpuTimer::collect()
+{
+    return detail_->collect();
+}
+
+std::size_t GpuTimer::pending() const
+{
+    return detail_->ranges.size();
+}
+
+GpuTimer::StatsMap GpuTimer::stats() const
+{
+    StatsMap stats;
+    for (const auto &item : detail_->labels) {
+        if (item.second.count) {
+            stats.insert(StatsMap::value_type(item.first
+                                              , item.second.stats()));
+        }
+    }
+    return stats;
+}
+
+void GpuTimer::reset()
+{
+    // pending ranges point to labels, keep the nodes
+    for (auto &item : detail_->labels) { item.second = Label(); }
+}
+
+void GpuTimer::log() const
+{
+    for (const auto &item : stats()) {
+        const auto &s(item.second);
+        LOG(info3)
+            << "GPU time <" << item.first << ">: count=" << s.count
+            << ", min=" << s.min / 1e6 << " ms, mean=" << s.mean / 1e6
+            << " ms, p99=" << s.p99 / 1e6 << " ms, max=" << s.max / 1e6
+            << " ms.";
+    }
+}
+
+void GpuTimer::json(std::ostream &os) const
+{
+    os << '{';
+    bool comma(false);
+    for (const auto &item : stats()) {
+        const auto &s(item.second);
+        if (comma) { os << ','; }
+        comma = true;
+
+        jsonString(os, item.first);
+        os << ":{\"count\":" << s.count
+           << ",\"min\":" << s.min / 1e6
+           << ",\"max\":" << s.max / 1e6
+           << ",\"mean\":" << s.mean / 1e6
+           << ",\"p99\":" << s.p99 / 1e6
+           << '}';
+    }
+    os << '}';
+}
+
+} // namespace glsupport
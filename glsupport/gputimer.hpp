@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef gputimer_hpp_included_
+#define gputimer_hpp_included_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <iosfwd>
+
+#include "utility/gl.hpp"
+
+namespace glsupport {
+
+/** GPU-side timing of labeled command ranges.
+ *
+ *  Each range is bracketed by a pair of GL_TIMESTAMP queries
+ *  (glQueryCounter), therefore ranges can nest and overlap. Results are
+ *  never waited for: collect() picks up only results that are already
+ *  available and leaves the rest for the next call. Query objects are
+ *  recycled.
+ *
+ *  Usage:
+ *      GpuTimer timer;
+ *      for (;;) {
+ *          { auto s(timer.scope("shadows")); renderShadows(); }
+ *          { auto s(timer.scope("scene")); renderScene(); }
+ *          swap();
+ *          timer.collect(); // results of previous frame(s)
+ *      }
+ *      timer.log();
+ *
+ *  Timer belongs to the context it is used in; all operations must be
+ *  performed with that context current.
+ */
+class GpuTimer {
+public:
+    class Scope;
+
+    /** Per-label statistics, times in nanoseconds.
+     */
+    struct Stats {
+        std::size_t count;
+        double min;
+        double max;
+        double mean;
+
+        /** 99th percentile over last `window` samples.
+         */
+        double p99;
+
+        Stats() : count(), min(), max(), mean(), p99() {}
+    };
+
+    typedef std::map<std::string, Stats> StatsMap;
+
+    /**
+     * \param window number of latest samples per label kept for percentile
+     *               computation
+     */
+    GpuTimer(std::size_t window = 1024);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    /** Starts timing of labeled range. Range ends when returned scope is
+     *  destroyed.
+     */
+    Scope scope(const std::string &label);
+
+    /** Collects available results; non-blocking.
+     *
+     * \return number of collected ranges
+     */
+    std::size_t collect();
+
+    /** Number of ranges still waiting for results.
+     */
+    std::size_t pending() const;
+
+    /** Statistics of all labels.
+     */
+    StatsMap stats() const;
+
+    /** Drops all collected statistics; pending ranges are kept.
+     */
+    void reset();
+
+    /** Logs statistics of all labels via dbglog.
+     */
+    void log() const;
+
+    /** Writes statistics of all labels as JSON object
+     *  (label -> {count, min, max, mean, p99}), times in milliseconds.
+     */
+    void json(std::ostream &os) const;
+
+private:
+    struct Detail;
+    std::unique_ptr<Detail> detail_;
+};
+
+/** Scoped timed range. Move-only, must not outlive its timer.
+ */
+class GpuTimer::Scope {
+public:
+    Scope(Scope &&o) : detail_(o.detail_), range_(o.range_) {
+        o.detail_ = nullptr;
+    }
+    ~Scope() { end(); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+    /** Ends the range before scope destruction.
+     */
+    void end();
+
+private:
+    friend class GpuTimer;
+    Scope(Detail *detail, std::size_t range)
+        : detail_(detail), range_(range)
+    {}
+
+    Detail *detail_;
+    std::size_t range_;
+};
+
+} // namespace glsupport
+
+#endif // gputimer_hpp_included_
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef hash_hpp_included_
+#define hash_hpp_included_
+
+#include <cstdint>
+#include <string>
+
+namespace glsupport {
+
+/** Incremental 64-bit FNV-1a hasher.
+ */
+class Hasher {
+public:
+    static constexpr std::uint64_t basis = 0xcbf29ce484222325ull;
+    static constexpr std::uint64_t prime = 0x100000001b3ull;
+
+    Hasher() : value_(basis) {}
+
+    Hasher& update(const void *data, std::size_t size) {
+        auto d(static_cast<const unsigned char*>(data));
+        for (auto e(d + size); d != e; ++d) {
+            value_ = (value_ ^ *d) * prime;
+        }
+        return *this;
+    }
+
+    /** Hashes string including terminating zero to separate adjacent
+     *  strings.
+     */
+    Hasher& update(const std::string &str) {
+        return update(str.c_str(), str.size() + 1);
+    }
+
+    template <typename T>
+    Hasher& pod(const T &value) { return update(&value, sizeof(value)); }
+
+    std::uint64_t value() const { return value_; }
+
+    /** Value as fixed width hexadecimal string.
+     */
+    std::string hex() const;
+
+private:
+    std::uint64_t value_;
+};
+
+/** Formats hash value as fixed width hexadecimal string.
+ */
+std::string hex(std::uint64_t value);
+
+/** FNV-1a hash of zero-terminated string (terminator not included). Usable
+ *  in constant expressions.
+ */
+constexpr std::uint64_t fnv1a(const char *str
+                              , std::uint64_t value = Hasher::basis)
+{
+    return (*str
+            ? fnv1a(str + 1, (value ^ static_cast<unsigned char>(*str))
+                    * Hasher::prime)
+            : value);
+}
+
+// inlines
+
+inline std::string Hasher::hex() const
+{
+    return glsupport::hex(value_);
+}
+
+inline std::string hex(std::uint64_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out(16, '0');
+    auto v(value);
+    for (auto i(out.rbegin()), e(out.rend()); i != e; ++i, v >>= 4) {
+        *i = digits[v & 0xf];
+    }
+    return out;
+}
+
+} // namespace glsupport
+
+#endif // hash_hpp_included_
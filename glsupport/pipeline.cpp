@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./pipeline.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+
+namespace glsupport {
+
+void ProgramPipeline::Detail::forget(::GLbitfield stages)
+{
+    for (auto &item : programs) { item.first &= ~stages; }
+
+    // drop programs not used by any stage
+    programs.erase(std::remove_if(programs.begin(), programs.end()
+                                  , [](const StageProgram &item)
+                                  {
+                                      return !item.first;
+                                  })
+                   , programs.end());
+}
+
+ProgramPipeline::ProgramPipeline()
+    : detail_(std::make_shared<Detail>())
+{
+    detail_->id.reset(new ::GLuint(), [](::GLuint *id) {
+            ::glDeleteProgramPipelines(1, id);
+            delete id;
+        });
+
+    ::glGenProgramPipelines(1, detail_->id.get());
+    if (!get()) {
+        LOGTHROW(err2, Error) << "Cannot create GL program pipeline.";
+    }
+}
+
+ProgramPipeline& ProgramPipeline::use(::GLbitfield stages
+                                      , const Program &program)
+{
+    program.check();
+    ::glUseProgramStages(get(), stages, program.get());
+    checkGl("use program stages");
+
+    detail_->forget(stages);
+    detail_->programs.emplace_back(stages, program);
+    return *this;
+}
+
+ProgramPipeline& ProgramPipeline::use(const Program &program)
+{
+    const auto stages(program.stageBits());
+    if (!stages) {
+        LOGTHROW(err2, Error)
+            << "Program " << program.get()
+            << " has unknown stages, specify them explicitly.";
+    }
+    return use(stages, program);
+}
+
+ProgramPipeline& ProgramPipeline::clear(::GLbitfield stages)
+{
+    if (!stages) { return *this; }
+
+    ::glUseProgramStages(get(), stages, 0);
+    checkGl("clear program stages");
+
+    detail_->forget(stages);
+    return *this;
+}
+
+ProgramPipeline& ProgramPipeline::activeProgram(const Program &program)
+{
+    ::glActiveShaderProgram(get(), program.get());
+    checkGl("active shader program");
+    return *this;
+}
+
+void ProgramPipeline::bind() const
+{
+    state::useProgram(0);
+    ::glBindProgramPipeline(get());
+}
+
+void ProgramPipeline::unbind() const
+{
+    ::glBindProgramPipeline(0);
+}
+
+void ProgramPipeline::validate() const
+{
+    ::glValidateProgramPipeline(get());
+
+    ::GLint valid(GL_FALSE);
+    ::glGetProgramPipelineiv(get(), GL_VALIDATE_STATUS, &valid);
+    if (valid) { return; }
+
+    ::GLint length(0);
+    ::glGetProgramPipelineiv(get(), GL_INFO_LOG_LENGTH, &length);
+    std::vector<char> log(length + 1);
+    ::glGetProgramPipelineInfoLog(get(), length, nullptr, log.data());
+
+    LOGTHROW(err2, Error)
+        << "Program pipeline " << get() << " is invalid: " << log.data();
+}
+
+} // namespace glsupport
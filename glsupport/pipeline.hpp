@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef pipeline_hpp_included_
+#define pipeline_hpp_included_
+
+#include <memory>
+#include <vector>
+
+#include "utility/gl.hpp"
+
+#include "./shader.hpp"
+
+namespace glsupport {
+
+/** Program pipeline object: combines stages of separable programs
+ *  (linked with Program::separable) without relinking, e.g. single vertex
+ *  stage with many fragment stages:
+ *
+ *      Program vs, fs1, fs2;
+ *      vs.link(vertex, {}, Program::separable);
+ *      fs1.link(fragment1, {}, Program::separable);
+ *      ...
+ *      ProgramPipeline p;
+ *      p.use(vs).use(fs1).bind();
+ *      draw();
+ *      p.use(fs2);
+ *      draw();
+ *
+ *  Uniforms of individual programs must be set by glProgramUniform*
+ *  (program.uniform() gives locations). Pipeline keeps its programs alive.
+ *
+ *  Shared handle; pipeline is deleted when last copy goes away. Pipeline
+ *  objects are not shared between contexts.
+ */
+class ProgramPipeline {
+public:
+    /** Creates new pipeline object.
+     */
+    ProgramPipeline();
+
+    /** Uses given stages of separable program.
+     *
+     * \param stages stage bits (GL_VERTEX_SHADER_BIT...)
+     * \param program separable program
+     */
+    ProgramPipeline& use(::GLbitfield stages, const Program &program);
+
+    /** Uses all stages of separable program (Program::stageBits()).
+     */
+    ProgramPipeline& use(const Program &program);
+
+    /** Removes program from given stages.
+     */
+    ProgramPipeline& clear(::GLbitfield stages);
+
+    /** Program receiving glUniform* calls while the pipeline is bound.
+     */
+    ProgramPipeline& activeProgram(const Program &program);
+
+    /** Binds pipeline. Program bound by glUseProgram (if any) is unbound
+     *  first since it would take precedence.
+     */
+    void bind() const;
+
+    /** Unbinds any pipeline.
+     */
+    void unbind() const;
+
+    /** Validates pipeline against current GL state, throws on failure.
+     */
+    void validate() const;
+
+    ::GLuint get() const { return *detail_->id; }
+    operator ::GLuint() const { return get(); }
+
+private:
+    struct Detail {
+        typedef std::pair< ::GLbitfield, Program> StageProgram;
+
+        std::shared_ptr< ::GLuint> id;
+
+        /** Programs and stages they are used for, keeps programs alive.
+         */
+        std::vector<StageProgram> programs;
+
+        /** Removes given stages from programs.
+         */
+        void forget(::GLbitfield stages);
+    };
+
+    std::shared_ptr<Detail> detail_;
+};
+
+} // namespace glsupport
+
+#endif // pipeline_hpp_included_
@@ -0,0 +1,300 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./preprocessor.hpp"
+#include "./hash.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+const std::string defaultVersion("330 core");
+
+constexpr int maxIncludeDepth(32);
+
+/** Removes "." and empty components, resolves "..".
+ */
+std::string normalize(const std::string &path)
+{
+    std::vector<std::string> parts;
+    std::istringstream is(path);
+    for (std::string part; std::getline(is, part, '/'); ) {
+        if (part.empty() || (part == ".")) { continue; }
+        if (part == "..") {
+            if (!parts.empty()) { parts.pop_back(); }
+            continue;
+        }
+        parts.push_back(part);
+    }
+
+    std::string out;
+    for (const auto &part : parts) {
+        if (!out.empty()) { out.push_back('/'); }
+        out.append(part);
+    }
+    return out;
+}
+
+std::string dirname(const std::string &path)
+{
+    const auto slash(path.rfind('/'));
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash);
+}
+
+std::string trim(const std::string &str)
+{
+    const auto b(str.find_first_not_of(" \t"));
+    if (b == std::string::npos) { return {}; }
+    return str.substr(b, str.find_last_not_of(" \t") - b + 1);
+}
+
+enum class Directive { none, include, version, extension, pragmaOnce };
+
+/** Recognizes directives handled by the preprocessor.
+ */
+Directive directive(const std::string &line, std::string &arg)
+{
+    auto b(line.find_first_not_of(" \t"));
+    if ((b == std::string::npos) || (line[b] != '#')) {
+        return Directive::none;
+    }
+
+    b = line.find_first_not_of(" \t", b + 1);
+    if (b == std::string::npos) { return Directive::none; }
+    const auto e(std::min(line.find_first_of(" \t\"<", b), line.size()));
+    const auto name(line.substr(b, e - b));
+
+    // drop trailing line comment
+    auto rest(line.substr(e));
+    rest = trim(rest.substr(0, rest.find("//")));
+
+    if (name == "include") {
+        if ((rest.size() >= 2)
+            && (((rest.front() == '"') && (rest.back() == '"'))
+                || ((rest.front() == '<') && (rest.back() == '>'))))
+        {
+            arg = rest.substr(1, rest.size() - 2);
+            return Directive::include;
+        }
+        LOGTHROW(err2, Error) << "Malformed #include directive: " << line;
+    }
+
+    if (name == "version") { arg = rest; return Directive::version; }
+    if (name == "extension") { arg = rest; return Directive::extension; }
+    if ((name == "pragma") && (rest == "once")) {
+        return Directive::pragmaOnce;
+    }
+    return Directive::none;
+}
+
+struct Processor {
+    typedef std::function<bool(const std::string&, std::string&)> Load;
+
+    Load load;
+    ShaderSource &out;
+
+    std::vector<std::string> stack;
+    std::set<std::string> once;
+    std::vector<std::string> extensions;
+    std::string version;
+    std::ostringstream body;
+
+    Processor(const Load &load, ShaderSource &out) : load(load), out(out) {}
+
+    void process(const std::string &path, const std::string &source);
+};
+
+void Processor::process(const std::string &path, const std::string &source)
+{
+    if (stack.size() >= std::size_t(maxIncludeDepth)) {
+        LOGTHROW(err2, Error)
+            << "Shader include depth limit reached in <" << path << ">.";
+    }
+
+    const auto index(out.files.size());
+    out.files.push_back(path);
+    stack.push_back(path);
+
+    body << "#line 1 " << index << '\n';
+
+    std::istringstream is(source);
+    std::size_t lineNo(0);
+    std::string arg;
+    for (std::string line; std::getline(is, line); ) {
+        ++lineNo;
+        if (!line.empty() && (line.back() == '\r')) { line.pop_back(); }
+
+        switch (directive(line, arg)) {
+        case Directive::none:
+            body << line << '\n';
+            continue;
+
+        case Directive::version:
+            // main file's version is kept unless overridden
+            if ((stack.size() == 1) && version.empty()) { version = arg; }
+            body << '\n';
+            continue;
+
+        case Directive::extension:
+            if (std::find(extensions.begin(), extensions.end(), arg)
+                == extensions.end())
+            {
+                extensions.push_back(arg);
+            }
+            body << '\n';
+            continue;
+
+        case Directive::pragmaOnce:
+            once.insert(path);
+            body << '\n';
+            continue;
+
+        case Directive::include:
+            break;
+        }
+
+        // relative to including file, then to the root
+        std::string resolved, content;
+        for (const auto &candidate
+                 : { normalize(dirname(path) + "/" + arg), normalize(arg) })
+        {
+            if (load(candidate, content)) { resolved = candidate; break; }
+        }
+
+        if (resolved.empty()) {
+            LOGTHROW(err2, Error)
+                << "Shader include <" << arg << "> not found (included from "
+                << path << ":" << lineNo << ").";
+        }
+
+        if (once.count(resolved)) {
+            body << '\n';
+            continue;
+        }
+
+        if (std::find(stack.begin(), stack.end(), resolved) != stack.end()) {
+            LOGTHROW(err2, Error)
+                << "Shader include cycle: <" << resolved
+                << "> included from " << path << ":" << lineNo << ".";
+        }
+
+        process(resolved, content);
+        body << "#line " << (lineNo + 1) << ' ' << index << '\n';
+    }
+
+    stack.pop_back();
+}
+
+} // namespace
+
+ShaderPreprocessor::ShaderPreprocessor(const Loader &loader
+                                       , const std::string &version)
+    : loader_(loader), version_(version)
+{}
+
+void ShaderPreprocessor::add(const std::string &path
+                             , const std::string &source)
+{
+    files_[normalize(path)] = source;
+}
+
+bool ShaderPreprocessor::load(const std::string &path
+                              , std::string &source) const
+{
+    auto ffiles(files_.find(path));
+    if (ffiles != files_.end()) {
+        source = ffiles->second;
+        return true;
+    }
+    return loader_ && loader_(path, source);
+}
+
+ShaderSource ShaderPreprocessor::file(const std::string &path
+                                      , const Defines &defines) const
+{
+    const auto normalized(normalize(path));
+    std::string content;
+    if (!load(normalized, content)) {
+        LOGTHROW(err2, Error) << "Shader file <" << path << "> not found.";
+    }
+    return source(content, defines, normalized);
+}
+
+ShaderSource ShaderPreprocessor::source(const std::string &source
+                                        , const Defines &defines
+                                        , const std::string &name) const
+{
+    ShaderSource out;
+    Processor processor([this](const std::string &path, std::string &src)
+                        {
+                            return load(path, src);
+                        }, out);
+    processor.process(name, source);
+
+    std::ostringstream os;
+    os << "#version "
+       << (!version_.empty() ? version_
+           : (!processor.version.empty() ? processor.version
+              : defaultVersion))
+       << '\n';
+    for (const auto &extension : processor.extensions) {
+        os << "#extension " << extension << '\n';
+    }
+    for (const auto &define : defines) {
+        os << "#define " << define.first;
+        if (!define.second.empty()) { os << ' ' << define.second; }
+        os << '\n';
+    }
+    os << processor.body.str();
+
+    out.source = os.str();
+    out.hash = Hasher().update(out.source).value();
+    return out;
+}
+
+ShaderPreprocessor::Loader
+ShaderPreprocessor::directory(const std::string &root)
+{
+    return [root](const std::string &path, std::string &source) -> bool
+    {
+        std::ifstream f(root + "/" + path, std::ios::binary);
+        if (!f) { return false; }
+        source.assign(std::istreambuf_iterator<char>(f)
+                      , std::istreambuf_iterator<char>());
+        return !f.bad();
+    };
+}
+
+} // namespace glsupport
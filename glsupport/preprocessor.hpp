@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef preprocessor_hpp_included_
+#define preprocessor_hpp_included_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glsupport {
+
+/** Preprocessed shader source.
+ */
+struct ShaderSource {
+    /** Final source text.
+     */
+    std::string source;
+
+    /** Paths of all files the source was assembled from; index in this
+     *  list is the source string number used in #line directives (and
+     *  therefore in compiler messages).
+     */
+    std::vector<std::string> files;
+
+    /** Hash of final source text.
+     */
+    std::uint64_t hash;
+
+    ShaderSource() : hash() {}
+};
+
+/** Shader source preprocessor.
+ *
+ *  Performs only what GLSL preprocessor cannot do itself:
+ *
+ *      * resolves #include "path" (and <path>) via virtual file system:
+ *        relative to including file first, then relative to the root;
+ *        #pragma once is honored, include cycles are errors; includes are
+ *        resolved unconditionally, even inside #if blocks
+ *      * normalizes header: exactly one #version directive at the very top
+ *        (configured version, otherwise the one from the main file,
+ *        otherwise "330 core"), followed by all #extension directives
+ *        (hoisted from all files) and injected #defines
+ *      * keeps line numbers by #line directives
+ *
+ *  Everything else (#ifdef etc.) is left to the GLSL compiler.
+ */
+class ShaderPreprocessor {
+public:
+    /** Define name -> value (empty value for plain #define NAME).
+     */
+    typedef std::map<std::string, std::string> Defines;
+
+    /** Loads file content from virtual file system; returns false when
+     *  there is no such file.
+     */
+    typedef std::function<bool(const std::string &path
+                               , std::string &source)> Loader;
+
+    /**
+     * \param loader file loader, may be empty (in-memory files only)
+     * \param version forced #version (e.g. "330 core"), empty to keep
+     *                main file's version
+     */
+    ShaderPreprocessor(const Loader &loader = Loader()
+                       , const std::string &version = "");
+
+    /** Adds in-memory file; in-memory files take precedence over loader.
+     */
+    void add(const std::string &path, const std::string &source);
+
+    /** Preprocesses file from virtual file system.
+     */
+    ShaderSource file(const std::string &path
+                      , const Defines &defines = Defines()) const;
+
+    /** Preprocesses given source; includes are resolved relative to the
+     *  root.
+     */
+    ShaderSource source(const std::string &source
+                        , const Defines &defines = Defines()
+                        , const std::string &name = "<source>") const;
+
+    /** Loader of files under given directory on disk.
+     */
+    static Loader directory(const std::string &root);
+
+private:
+    bool load(const std::string &path, std::string &source) const;
+
+    Loader loader_;
+    std::string version_;
+    std::map<std::string, std::string> files_;
+};
+
+} // namespace glsupport
+
+#endif // preprocessor_hpp_included_
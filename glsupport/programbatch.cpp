@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <new>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./programbatch.hpp"
+#include "./extensions.hpp"
+#include "./ext.hpp"
+
+namespace glsupport {
+
+namespace {
+
+typedef void (GLAPIENTRYP MaxShaderCompilerThreads)(::GLuint count);
+
+bool enableParallelCompile()
+{
+    const char *fn(nullptr);
+    if (hasExtension("GL_KHR_parallel_shader_compile")) {
+        fn = "glMaxShaderCompilerThreadsKHR";
+    } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+        fn = "glMaxShaderCompilerThreadsARB";
+    } else {
+        LOG(info1) << "Parallel shader compilation not supported.";
+        return false;
+    }
+
+    auto maxShaderCompilerThreads
+        (egl::ext::eglGetProcAddress<MaxShaderCompilerThreads>
+         (fn, std::nothrow));
+    if (!maxShaderCompilerThreads) {
+        LOG(warn2) << "Unable to get <" << fn << ">.";
+        return false;
+    }
+
+    // let the driver decide
+    maxShaderCompilerThreads(0xffffffff);
+    return true;
+}
+
+} // namespace
+
+ProgramBatch::ProgramBatch()
+    : parallel_(enableParallelCompile())
+{}
+
+Program ProgramBatch::add(const std::string &vs, const std::string &fs)
+{
+    return add(vs, fs, {});
+}
+
+Program ProgramBatch::add(const std::string &vs, const std::string &fs
+                          , const Program::Attributes &attributes)
+{
+    Program program;
+    program.linkDeferred(VertexShader::deferred(vs)
+                         , FragmentShader::deferred(fs)
+                         , attributes);
+    programs_.push_back(program);
+    return program;
+}
+
+std::size_t ProgramBatch::pending() const
+{
+    std::size_t count(0);
+    for (const auto &program : programs_) {
+        if (!program.ready()) { ++count; }
+    }
+    return count;
+}
+
+void ProgramBatch::check() const
+{
+    for (const auto &program : programs_) { program.check(); }
+}
+
+} // namespace glsupport
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef programbatch_hpp_included_
+#define programbatch_hpp_included_
+
+#include <vector>
+
+#include "./shader.hpp"
+
+namespace glsupport {
+
+/** Batch program builder.
+ *
+ *  All shaders and programs are submitted to the driver without querying
+ *  their status so the driver can compile them in the background. When
+ *  GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile is
+ *  available the driver is allowed to use as many compiler threads as it
+ *  likes and completion can be polled without blocking.
+ *
+ *  Errors are reported lazily by the returned programs (see
+ *  Program::linkDeferred) or by explicit check().
+ *
+ *  Usage:
+ *      ProgramBatch batch;
+ *      auto p1(batch.add(vs1, fs1));
+ *      auto p2(batch.add(vs2, fs2));
+ *      ...
+ *      while (!batch.ready()) { doSomethingElse(); }
+ *      p1.use();
+ */
+class ProgramBatch {
+public:
+    /** Enables parallel shader compilation in current context when
+     *  supported.
+     */
+    ProgramBatch();
+
+    /** Submits program build.
+     */
+    Program add(const std::string &vs, const std::string &fs);
+
+    /** Submits program build.
+     */
+    Program add(const std::string &vs, const std::string &fs
+                , const Program::Attributes &attributes);
+
+    /** Number of programs not finished yet. Does not block.
+     */
+    std::size_t pending() const;
+
+    /** Are all programs finished? Does not block.
+     */
+    bool ready() const { return !pending(); }
+
+    /** Checks status of all programs, throws on first failure. Blocks until
+     *  all programs are finished.
+     */
+    void check() const;
+
+    /** Is completion status pollable?
+     */
+    bool parallel() const { return parallel_; }
+
+    const std::vector<Program>& programs() const { return programs_; }
+
+private:
+    bool parallel_;
+    std::vector<Program> programs_;
+};
+
+} // namespace glsupport
+
+#endif // programbatch_hpp_included_
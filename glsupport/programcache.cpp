@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./programcache.hpp"
+#include "./hash.hpp"
+#include "./debug.hpp"
+
+namespace glsupport {
+
+namespace {
+
+const char Magic[8] = { 'G', 'L', 'S', 'P', 'B', 'I', 'N', '1' };
+
+struct Header {
+    char magic[sizeof(Magic)];
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t size;
+};
+
+std::string glString(::GLenum name)
+{
+    auto value(::glGetString(name));
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+std::uint64_t programKey(const std::string &vs, const std::string &fs
+                         , const Program::Attributes &attributes)
+{
+    Hasher hasher;
+    hasher.update(vs).update(fs);
+    for (const auto &attr : attributes.attrs) {
+        hasher.pod(attr.first).update(attr.second);
+    }
+
+    hasher.update(glString(GL_VENDOR))
+        .update(glString(GL_RENDERER))
+        .update(glString(GL_VERSION))
+        .update(glString(GL_SHADING_LANGUAGE_VERSION));
+
+    return hasher.value();
+}
+
+bool binarySupported()
+{
+    ::GLint formats(0);
+    ::glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+void makeDirectories(const std::string &path)
+{
+    for (auto pos(path.find('/', 1)); ; pos = path.find('/', pos + 1)) {
+        const auto dir(path.substr(0, pos));
+        if ((::mkdir(dir.c_str(), 0777) == -1) && (errno != EEXIST)) {
+            LOGTHROW(err2, Error)
+                << "Cannot create program cache directory <" << dir
+                << ">: " << std::strerror(errno) << ".";
+        }
+        if (pos == std::string::npos) { break; }
+    }
+}
+
+bool loadEntry(const std::string &path, std::uint64_t key
+               , Header &header, std::vector<char> &data)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { return false; }
+
+    if (!f.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, Magic, sizeof(Magic))
+        || (header.key != key))
+    {
+        LOG(warn2) << "Ignoring invalid program cache file <"
+                   << path << ">.";
+        return false;
+    }
+
+    data.resize(header.size);
+    if (!f.read(data.data(), data.size())) {
+        LOG(warn2) << "Ignoring truncated program cache file <"
+                   << path << ">.";
+        return false;
+    }
+
+    return true;
+}
+
+void storeEntry(const std::string &path, std::uint64_t key
+                , ::GLenum format, const std::vector<char> &data)
+{
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.key = key;
+    header.format = format;
+    header.size = data.size();
+
+    std::string tmp(path + ".XXXXXX");
+    auto fd(::mkstemp(&tmp[0]));
+    if (fd == -1) {
+        LOG(warn2) << "Cannot create temporary program cache file <"
+                   << tmp << ">: " << std::strerror(errno) << ".";
+        return;
+    }
+
+    auto write([&](const void *d, std::size_t size) -> bool
+    {
+        auto p(static_cast<const char*>(d));
+        while (size) {
+            auto written(::write(fd, p, size));
+            if (written == -1) {
+                if (errno == EINTR) { continue; }
+                return false;
+            }
+            p += written;
+            size -= written;
+        }
+        return true;
+    });
+
+    bool ok(write(&header, sizeof(header)) && write(data.data(), data.size())
+            && !::fchmod(fd, 0644));
+    auto error(ok ? 0 : errno);
+
+    // close exactly once: descriptor is released even when close fails
+    if (::close(fd) && ok) {
+        ok = false;
+        error = errno;
+    }
+
+    if (!ok) {
+        LOG(warn2) << "Cannot write program cache file <"
+                   << tmp << ">: " << std::strerror(error) << ".";
+        ::unlink(tmp.c_str());
+        return;
+    }
+
+    // atomically replace any existing entry
+    if (::rename(tmp.c_str(), path.c_str()) == -1) {
+        LOG(warn2) << "Cannot store program cache file <"
+                   << path << ">: " << std::strerror(errno) << ".";
+        ::unlink(tmp.c_str());
+    }
+}
+
+} // namespace
+
+ProgramCache::ProgramCache(const std::string &root)
+    : root_(root)
+{
+    if (root_.empty()) {
+        LOGTHROW(err2, Error) << "Empty program cache directory.";
+    }
+    makeDirectories(root_);
+}
+
+Program ProgramCache::program(const std::string &vs, const std::string &fs
+                              , const Program::Attributes &attributes)
+{
+    Program program;
+
+    if (!binarySupported()) {
+        // no binary formats, plain compilation
+        ++stats_.misses;
+        program.link(vs, fs, attributes);
+        return program;
+    }
+
+    const auto key(programKey(vs, fs, attributes));
+    const auto path(root_ + "/" + hex(key) + ".bin");
+
+    Header header;
+    std::vector<char> data;
+    if (loadEntry(path, key, header, data)) {
+        if (program.load(header.format, data.data(), data.size())) {
+            ++stats_.hits;
+            program.label("cached:" + hex(key));
+            return program;
+        }
+        ++stats_.rejected;
+    }
+
+    ++stats_.misses;
+    program.link(vs, fs, attributes, Program::binaryRetrievable);
+    program.label("cached:" + hex(key));
+
+    ::GLenum format(0);
+    data = program.binary(format);
+    if (!data.empty()) {
+        storeEntry(path, key, format, data);
+    }
+
+    return program;
+}
+
+} // namespace glsupport
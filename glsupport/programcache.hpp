@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef programcache_hpp_included_
+#define programcache_hpp_included_
+
+#include <string>
+
+#include "./shader.hpp"
+
+namespace glsupport {
+
+/** Persistent on-disk cache of linked program binaries.
+ *
+ *  Programs are keyed by hash of shader sources, attribute bindings and
+ *  driver identification (vendor, renderer, version and GLSL version
+ *  strings), therefore driver update invalidates cached binaries
+ *  automatically.
+ *
+ *  Cache files are written atomically (temporary file + rename), multiple
+ *  processes can share single cache directory.
+ *
+ *  All operations must be performed with GL context current.
+ */
+class ProgramCache {
+public:
+    struct Stats {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t rejected;
+
+        Stats() : hits(), misses(), rejected() {}
+    };
+
+    /** Opens cache in given directory. Directory is created when missing.
+     */
+    ProgramCache(const std::string &root);
+
+    /** Builds program from given sources. Cached binary is used when
+     *  available and accepted by driver, otherwise program is compiled from
+     *  sources and its binary is stored in the cache.
+     */
+    Program program(const std::string &vs, const std::string &fs
+                    , const Program::Attributes &attributes = {});
+
+    const Stats& stats() const { return stats_; }
+
+    const std::string& root() const { return root_; }
+
+private:
+    std::string root_;
+    Stats stats_;
+};
+
+} // namespace glsupport
+
+#endif // programcache_hpp_included_
@@ -0,0 +1,455 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./programregistry.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Quiet period (ms) after last change before programs are rebuilt; editors
+ *  tend to save files in several steps.
+ */
+constexpr int settleTimeout(50);
+
+std::string dirname(const std::string &path)
+{
+    const auto slash(path.rfind('/'));
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash);
+}
+
+} // namespace
+
+struct ProgramRegistry::Entry {
+    const std::string vs;
+    const std::string fs;
+    const Defines defines;
+
+    /** Attribute bindings; names are owned here.
+     */
+    std::vector<std::pair< ::GLuint, std::string> > attributes;
+
+    /** Current program and its generation; rendering thread only.
+     */
+    Program program;
+    unsigned int generation;
+
+    /** Files the program is built from; guarded by registry mutex.
+     */
+    std::set<std::string> files;
+
+    /** Rebuilt program waiting for swap and last rebuild error.
+     */
+    mutable std::mutex mutex;
+    Program pending;
+    bool hasPending;
+    std::string error;
+
+    Entry(const std::string &vs, const std::string &fs
+          , const Defines &defines, const Program::Attributes &attributes)
+        : vs(vs), fs(fs), defines(defines), generation(), hasPending(false)
+    {
+        for (const auto &attr : attributes.attrs) {
+            this->attributes.emplace_back(attr.first, attr.second);
+        }
+    }
+
+    std::string name() const { return vs + "+" + fs; }
+
+    /** Builds program. Files are filled in as soon as the sources are
+     *  preprocessed, i.e. even when compilation fails.
+     */
+    Program build(const ShaderPreprocessor &preprocessor
+                  , std::set<std::string> &files) const
+    {
+        const auto vsSource(preprocessor.file(vs, defines));
+        const auto fsSource(preprocessor.file(fs, defines));
+        files.insert(vsSource.files.begin(), vsSource.files.end());
+        files.insert(fsSource.files.begin(), fsSource.files.end());
+
+        Program::Attributes attrs;
+        for (const auto &attr : attributes) {
+            attrs(attr.first, attr.second.c_str());
+        }
+
+        Program program;
+        program.link(VertexShader(vsSource.source)
+                     , FragmentShader(fsSource.source), attrs);
+        program.label(name());
+        return program;
+    }
+};
+
+struct ProgramRegistry::Detail {
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    const std::string root;
+    const egl::Context context;
+    const egl::Surface surface;
+    const ::EGLenum api;
+    const ShaderPreprocessor preprocessor;
+
+    /** Guards entries, their files and watches.
+     */
+    mutable std::mutex mutex;
+    std::vector<EntryPtr> entries;
+
+    /** Watch descriptor -> watched directory (relative to root).
+     */
+    std::map<int, std::string> watches;
+    std::set<std::string> directories;
+
+    int inotify;
+    int wakeup;
+    std::atomic<bool> stop;
+    std::atomic<bool> reloadAll;
+    std::thread thread;
+
+    Detail(const std::string &root, const egl::Context &context
+           , const egl::Surface &surface)
+        : root(root), context(context), surface(surface)
+        , api(::eglQueryAPI())
+        , preprocessor(ShaderPreprocessor::directory(root))
+        , inotify(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+        , wakeup(-1), stop(false), reloadAll(false)
+    {
+        if (inotify == -1) {
+            LOGTHROW(err2, Error)
+                << "Cannot initialize inotify: " << std::strerror(errno)
+                << ".";
+        }
+
+        wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup == -1) {
+            const auto e(errno);
+            ::close(inotify);
+            LOGTHROW(err2, Error)
+                << "Cannot create eventfd: " << std::strerror(e) << ".";
+        }
+
+        thread = std::thread(&Detail::run, this);
+    }
+
+    ~Detail() {
+        stop = true;
+        wake();
+        thread.join();
+        ::close(wakeup);
+        ::close(inotify);
+    }
+
+    void wake() {
+        const std::uint64_t one(1);
+        if (::write(wakeup, &one, sizeof(one)) == -1) {
+            LOG(warn2) << "Cannot wake up program registry thread: "
+                       << std::strerror(errno) << ".";
+        }
+    }
+
+    /** Starts watching directories of given files. Mutex must be held.
+     */
+    void watch(const std::set<std::string> &files);
+
+    void run();
+
+    /** Processes pending inotify events, collects affected entries.
+     */
+    void changed(std::set<EntryPtr> &dirty);
+
+    void rebuild(const std::set<EntryPtr> &dirty);
+};
+
+void ProgramRegistry::Detail::watch(const std::set<std::string> &files)
+{
+    for (const auto &file : files) {
+        const auto dir(dirname(file));
+        if (directories.count(dir)) { continue; }
+
+        const auto path(dir.empty() ? root : root + "/" + dir);
+        const auto wd(::inotify_add_watch(inotify, path.c_str()
+                                          , IN_CLOSE_WRITE | IN_MOVED_TO));
+        if (wd == -1) {
+            // retried on next rebuild
+            LOG(warn2) << "Cannot watch shader directory <" << path
+                       << ">: " << std::strerror(errno) << ".";
+            continue;
+        }
+
+        watches[wd] = dir;
+        directories.insert(dir);
+        LOG(info1) << "Watching shader directory <" << path << ">.";
+    }
+}
+
+void ProgramRegistry::Detail::run()
+{
+    std::set<EntryPtr> dirty;
+    while (!stop) {
+        ::pollfd fds[2] = { { inotify, POLLIN, 0 }, { wakeup, POLLIN, 0 } };
+
+        // wait until changes settle down
+        const auto res(::poll(fds, 2, dirty.empty() ? -1 : settleTimeout));
+        if (res == -1) {
+            if (errno == EINTR) { continue; }
+            LOG(err2) << "Program registry: poll failed: "
+                      << std::strerror(errno) << "; not watching anymore.";
+            break;
+        }
+
+        if (stop) { break; }
+
+        if (!res) {
+            rebuild(dirty);
+            dirty.clear();
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            std::uint64_t value;
+            if (::read(wakeup, &value, sizeof(value)) == -1) {
+                LOG(warn2) << "Cannot read from eventfd: "
+                           << std::strerror(errno) << ".";
+            }
+            if (reloadAll.exchange(false)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                dirty.insert(entries.begin(), entries.end());
+            }
+        }
+
+        if (fds[0].revents & POLLIN) { changed(dirty); }
+    }
+
+    try {
+        context.release();
+    } catch (const std::exception &e) {
+        LOG(err2) << "Program registry: " << e.what();
+    }
+}
+
+void ProgramRegistry::Detail::changed(std::set<EntryPtr> &dirty)
+{
+    alignas(::inotify_event) char buffer[4096];
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (;;) {
+        const auto size(::read(inotify, buffer, sizeof(buffer)));
+        if (size <= 0) { break; }
+
+        for (const char *p(buffer), *e(buffer + size); p < e; ) {
+            const auto *event(reinterpret_cast<const ::inotify_event*>(p));
+            p += sizeof(::inotify_event) + event->len;
+
+            auto fwatches(watches.find(event->wd));
+            if (fwatches == watches.end()) { continue; }
+
+            if (event->mask & IN_IGNORED) {
+                // directory is gone, watch it again on next rebuild
+                directories.erase(fwatches->second);
+                watches.erase(fwatches);
+                continue;
+            }
+
+            if (!event->len) { continue; }
+
+            const std::string name(event->name);
+            const auto path(fwatches->second.empty()
+                            ? name : fwatches->second + "/" + name);
+
+            for (const auto &entry : entries) {
+                if (entry->files.count(path)) {
+                    LOG(info2) << "Shader file <" << path
+                               << "> changed, rebuilding program <"
+                               << entry->name() << ">.";
+                    dirty.insert(entry);
+                }
+            }
+        }
+    }
+}
+
+void ProgramRegistry::Detail::rebuild(const std::set<EntryPtr> &dirty)
+{
+    try {
+        // no-op when already current
+        if (!::eglBindAPI(api)) {
+            LOGTHROW(err2, Error)
+                << "EGL: Cannot bind client API " << api << ".";
+        }
+        context.makeCurrent(surface);
+    } catch (const std::exception &e) {
+        LOG(err2) << "Program registry: cannot make context current, "
+                  "programs not rebuilt: " << e.what();
+        return;
+    }
+
+    struct Built {
+        EntryPtr entry;
+        Program program;
+        std::set<std::string> files;
+    };
+    std::vector<Built> built;
+
+    for (const auto &entry : dirty) {
+        std::set<std::string> files;
+        try {
+            auto program(entry->build(preprocessor, files));
+            built.push_back({ entry, program, files });
+        } catch (const std::exception &e) {
+            LOG(err2) << "Failed to rebuild program <" << entry->name()
+                      << ">, keeping previous one: " << e.what();
+            {
+                std::lock_guard<std::mutex> lock(entry->mutex);
+                entry->error = e.what();
+            }
+
+            // watch newly included files as well to catch the fix
+            std::lock_guard<std::mutex> lock(mutex);
+            entry->files.insert(files.begin(), files.end());
+            watch(entry->files);
+        }
+    }
+
+    if (built.empty()) { return; }
+
+    // make programs complete and visible to other contexts
+    ::glFinish();
+
+    for (const auto &b : built) {
+        {
+            std::lock_guard<std::mutex> lock(b.entry->mutex);
+            b.entry->pending = b.program;
+            b.entry->hasPending = true;
+            b.entry->error.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        b.entry->files = b.files;
+        watch(b.files);
+        LOG(info3) << "Program <" << b.entry->name() << "> rebuilt.";
+    }
+}
+
+ProgramRegistry::ProgramRegistry(const std::string &root
+                                 , const egl::Context &context
+                                 , const egl::Surface &surface)
+    : detail_(new Detail(root, context, surface))
+{}
+
+ProgramRegistry::~ProgramRegistry() {}
+
+ProgramRegistry::Handle
+ProgramRegistry::add(const std::string &vs, const std::string &fs
+                     , const Defines &defines
+                     , const Program::Attributes &attributes)
+{
+    auto entry(std::make_shared<Entry>(vs, fs, defines, attributes));
+
+    std::set<std::string> files;
+    entry->program = entry->build(detail_->preprocessor, files);
+
+    std::lock_guard<std::mutex> lock(detail_->mutex);
+    entry->files = files;
+    detail_->watch(files);
+    detail_->entries.push_back(entry);
+    return Handle(entry);
+}
+
+std::size_t ProgramRegistry::update()
+{
+    std::vector<Detail::EntryPtr> entries;
+    {
+        std::lock_guard<std::mutex> lock(detail_->mutex);
+        entries = detail_->entries;
+    }
+
+    std::size_t swapped(0);
+    for (const auto &entry : entries) {
+        Program old;
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            if (!entry->hasPending) { continue; }
+            old = entry->program;
+            entry->program = entry->pending;
+            entry->pending = Program();
+            entry->hasPending = false;
+        }
+        ++entry->generation;
+        ++swapped;
+    }
+
+    if (swapped) {
+        LOG(info2) << "Swapped in " << swapped << " rebuilt program(s).";
+    }
+    return swapped;
+}
+
+void ProgramRegistry::reload()
+{
+    detail_->reloadAll = true;
+    detail_->wake();
+}
+
+std::size_t ProgramRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(detail_->mutex);
+    return detail_->entries.size();
+}
+
+const Program& ProgramRegistry::Handle::program() const
+{
+    return entry_->program;
+}
+
+unsigned int ProgramRegistry::Handle::generation() const
+{
+    return entry_->generation;
+}
+
+std::string ProgramRegistry::Handle::error() const
+{
+    std::lock_guard<std::mutex> lock(entry_->mutex);
+    return entry_->error;
+}
+
+} // namespace glsupport
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef programregistry_hpp_included_
+#define programregistry_hpp_included_
+
+#include <memory>
+#include <string>
+
+#include "./shader.hpp"
+#include "./preprocessor.hpp"
+#include "./egl.hpp"
+
+namespace glsupport {
+
+/** Registry of programs reloaded when their sources change on disk.
+ *
+ *  Programs are built from files under root directory (run through
+ *  ShaderPreprocessor, i.e. includes are tracked as well). Background
+ *  thread watches the directories of all used files (inotify) and when any
+ *  of them changes it rebuilds affected programs on its own context. That
+ *  context must share objects with the rendering context(s).
+ *
+ *  Rebuilt programs are not visible until update() is called by the
+ *  rendering thread, typically at frame boundary; all pending programs are
+ *  swapped in at once. When rebuild fails the error is logged and the
+ *  previous program stays in use.
+ *
+ *  Usage:
+ *      ProgramRegistry registry("shaders", backgroundContext);
+ *      auto terrain(registry.add("terrain.vs", "terrain.fs"));
+ *      for (;;) {
+ *          registry.update();
+ *          terrain->use();
+ *          draw();
+ *      }
+ */
+class ProgramRegistry {
+public:
+    typedef ShaderPreprocessor::Defines Defines;
+    class Handle;
+
+    /**
+     * \param root shader source directory
+     * \param context background context sharing objects with rendering
+     *                context(s); must not be current in any other thread
+     * \param surface surface for background context, empty for
+     *                surfaceless context
+     */
+    ProgramRegistry(const std::string &root, const egl::Context &context
+                    , const egl::Surface &surface = egl::Surface());
+
+    ~ProgramRegistry();
+
+    ProgramRegistry(const ProgramRegistry&) = delete;
+    ProgramRegistry& operator=(const ProgramRegistry&) = delete;
+
+    /** Builds program from given files (relative to root) and starts
+     *  watching them. Initial build is performed in calling thread with
+     *  rendering context current; throws on failure.
+     */
+    Handle add(const std::string &vs, const std::string &fs
+               , const Defines &defines = Defines()
+               , const Program::Attributes &attributes
+               = Program::Attributes());
+
+    /** Swaps in all programs rebuilt since last call. Must be called from
+     *  rendering thread. Returns number of swapped programs.
+     */
+    std::size_t update();
+
+    /** Schedules rebuild of all programs regardless of file changes.
+     */
+    void reload();
+
+    /** Number of registered programs.
+     */
+    std::size_t size() const;
+
+private:
+    struct Entry;
+    struct Detail;
+    std::unique_ptr<Detail> detail_;
+};
+
+/** Handle to registered program. Program behind the handle changes only in
+ *  ProgramRegistry::update(). Handle stays valid even after registry is
+ *  destroyed (program is not reloaded anymore).
+ */
+class ProgramRegistry::Handle {
+public:
+    Handle() {}
+
+    /** Current program.
+     */
+    const Program& program() const;
+
+    const Program* operator->() const { return &program(); }
+
+    /** Incremented each time new program is swapped in; useful to refresh
+     *  anything derived from the program (uniform values etc.).
+     */
+    unsigned int generation() const;
+
+    /** Error of last failed rebuild; empty when last rebuild succeeded.
+     */
+    std::string error() const;
+
+    explicit operator bool() const { return bool(entry_); }
+
+private:
+    friend class ProgramRegistry;
+
+    Handle(const std::shared_ptr<Entry> &entry) : entry_(entry) {}
+
+    std::shared_ptr<Entry> entry_;
+};
+
+} // namespace glsupport
+
+#endif // programregistry_hpp_included_
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dbglog/dbglog.hpp"
+
+#include "./programvariants.hpp"
+#include "./programcache.hpp"
+#include "./hash.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Compiles shader unless there is one with the same source already.
+ */
+template <typename ShaderType>
+ShaderType shader(std::map<std::uint64_t, ShaderType> &shaders
+                  , const ShaderSource &source, std::size_t &compiled)
+{
+    auto fshaders(shaders.find(source.hash));
+    if (fshaders != shaders.end()) { return fshaders->second; }
+
+    ShaderType shader(source.source);
+    ++compiled;
+    shaders.insert(std::make_pair(source.hash, shader));
+    return shader;
+}
+
+} // namespace
+
+ProgramVariants::ProgramVariants(const ShaderPreprocessor &preprocessor
+                                 , ProgramCache *cache)
+    : preprocessor_(preprocessor), cache_(cache)
+{}
+
+Program ProgramVariants::program(const std::string &vs
+                                 , const std::string &fs
+                                 , const Defines &defines
+                                 , const Program::Attributes &attributes)
+{
+    return program(preprocessor_.file(vs, defines)
+                   , preprocessor_.file(fs, defines), attributes);
+}
+
+Program ProgramVariants::program(const ShaderSource &vs
+                                 , const ShaderSource &fs
+                                 , const Program::Attributes &attributes)
+{
+    Hasher hasher;
+    hasher.pod(vs.hash).pod(fs.hash);
+    for (const auto &attr : attributes.attrs) {
+        hasher.pod(attr.first).update(attr.second);
+    }
+    const auto key(hasher.value());
+
+    auto fprograms(programs_.find(key));
+    if (fprograms != programs_.end()) {
+        ++stats_.hits;
+        return fprograms->second;
+    }
+
+    ++stats_.misses;
+
+    Program program;
+    if (cache_) {
+        program = cache_->program(vs.source, fs.source, attributes);
+    } else {
+        program.link(shader(vertexShaders_, vs, stats_.shaders)
+                     , shader(fragmentShaders_, fs, stats_.shaders)
+                     , attributes);
+    }
+
+    programs_.insert(std::make_pair(key, program));
+    return program;
+}
+
+void ProgramVariants::clear()
+{
+    programs_.clear();
+    vertexShaders_.clear();
+    fragmentShaders_.clear();
+}
+
+} // namespace glsupport
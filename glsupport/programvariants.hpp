@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef programvariants_hpp_included_
+#define programvariants_hpp_included_
+
+#include <map>
+#include <string>
+
+#include "./shader.hpp"
+#include "./preprocessor.hpp"
+
+namespace glsupport {
+
+class ProgramCache;
+
+/** Cache of program variants (permutations of one shader pair by defines).
+ *
+ *  Sources are run through the preprocessor and keyed by hash of the final
+ *  text: identical permutation requested again gets the existing Program
+ *  (programs are shared handles) and each distinct shader source is
+ *  compiled only once even when used by multiple programs.
+ *
+ *  When ProgramCache is given, programs are built through it (on-disk
+ *  binary cache) instead.
+ *
+ *  All operations must be performed with GL context current.
+ */
+class ProgramVariants {
+public:
+    typedef ShaderPreprocessor::Defines Defines;
+
+    struct Stats {
+        /** Programs found in the cache.
+         */
+        std::size_t hits;
+
+        /** Programs built.
+         */
+        std::size_t misses;
+
+        /** Shaders compiled.
+         */
+        std::size_t shaders;
+
+        Stats() : hits(), misses(), shaders() {}
+    };
+
+    /**
+     * \param preprocessor source preprocessor, must outlive this object
+     * \param cache optional on-disk program cache, must outlive this object
+     */
+    ProgramVariants(const ShaderPreprocessor &preprocessor
+                    , ProgramCache *cache = nullptr);
+
+    /** Returns program built from given files (looked up in preprocessor's
+     *  virtual file system) with given defines.
+     */
+    Program program(const std::string &vs, const std::string &fs
+                    , const Defines &defines = Defines());
+
+    Program program(const std::string &vs, const std::string &fs
+                    , const Defines &defines
+                    , const Program::Attributes &attributes);
+
+    /** Returns program built from already preprocessed sources.
+     */
+    Program program(const ShaderSource &vs, const ShaderSource &fs
+                    , const Program::Attributes &attributes);
+
+    /** Number of cached programs.
+     */
+    std::size_t size() const { return programs_.size(); }
+
+    /** Drops all cached programs and shaders; programs already handed out
+     *  stay valid.
+     */
+    void clear();
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    const ShaderPreprocessor &preprocessor_;
+    ProgramCache *cache_;
+
+    std::map<std::uint64_t, VertexShader> vertexShaders_;
+    std::map<std::uint64_t, FragmentShader> fragmentShaders_;
+    std::map<std::uint64_t, Program> programs_;
+
+    Stats stats_;
+};
+
+// inlines
+
+inline Program ProgramVariants::program(const std::string &vs
+                                        , const std::string &fs
+                                        , const Defines &defines)
+{
+    return program(vs, fs, defines, {});
+}
+
+} // namespace glsupport
+
+#endif // programvariants_hpp_included_
@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dbglog/dbglog.hpp"
+
+#include "./readback.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+
+namespace glsupport {
+
+struct Readback::Slot {
+    ::GLuint buffer;
+    std::size_t size;
+    std::size_t stride;
+    std::size_t sequence;
+    Fence fence;
+    bool mapped;
+
+    Slot(std::size_t size, std::size_t stride)
+        : buffer(), size(size), stride(stride), sequence(), mapped(false)
+    {
+        ::glGenBuffers(1, &buffer);
+        state::bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        ::glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        state::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        checkGl("readback buffer");
+    }
+
+    ~Slot() { state::deleteBuffers(1, &buffer); }
+
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+};
+
+Readback::Readback(const FrameBuffer &fb, std::size_t depth
+                   , std::size_t attachment)
+    : fb_(fb), attachment_(attachment), next_(), sequence_()
+{
+    if (!depth) {
+        LOGTHROW(err2, Error) << "Readback ring must have at least one slot.";
+    }
+    if (attachment >= fb.colorCount()) {
+        LOGTHROW(err2, Error)
+            << "Framebuffer has no color attachment " << attachment << ".";
+    }
+
+    const auto stride(fb.size().width * pixelSize(fb.pixelType(attachment)));
+    for (std::size_t i(0); i < depth; ++i) {
+        slots_.push_back(std::make_shared<Slot>
+                         (fb.byteSize(attachment), stride));
+    }
+}
+
+Readback::Frame Readback::read()
+{
+    auto &slot(slots_[next_]);
+    if (slot.use_count() > 1) {
+        LOGTHROW(err2, Error)
+            << "Readback ring overrun: slot " << next_
+            << " still holds frame " << slot->sequence << ".";
+    }
+    next_ = (next_ + 1) % slots_.size();
+
+    StateGuard guard;
+    guard.framebuffers();
+
+    ::GLint packAlignment(0);
+    ::glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+
+    // multisampled content must be resolved first
+    fb_.resolve();
+
+    state::bindFramebuffer(GL_READ_FRAMEBUFFER, fb_.readId());
+    ::glReadBuffer(::GLenum(GL_COLOR_ATTACHMENT0 + attachment_));
+    ::glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    state::bindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    const auto &size(fb_.size());
+    ::glReadPixels(0, 0, size.width, size.height
+                   , pixelFormat(fb_.pixelType(attachment_))
+                   , pixelComponentType(fb_.pixelType(attachment_))
+                   , nullptr);
+    state::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (attachment_) {
+        // read buffer is framebuffer state, restore default
+        ::glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+
+    ::glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+    checkGl("readback");
+
+    slot->fence = Fence::insert();
+    slot->sequence = sequence_++;
+
+    return Frame(slot);
+}
+
+bool Readback::Frame::ready() const
+{
+    return !slot_ || slot_->fence.signaled();
+}
+
+void Readback::Frame::wait() const
+{
+    if (slot_) { slot_->fence.wait(); }
+}
+
+std::size_t Readback::Frame::sequence() const
+{
+    if (!slot_) {
+        LOGTHROW(err2, Error) << "Empty readback frame has no sequence.";
+    }
+    return slot_->sequence;
+}
+
+Readback::Mapping Readback::Frame::map() const
+{
+    if (!slot_) {
+        LOGTHROW(err2, Error) << "Cannot map empty readback frame.";
+    }
+    wait();
+    return Mapping(slot_);
+}
+
+Readback::Mapping::Mapping(const std::shared_ptr<Slot> &slot)
+    : slot_(slot), data_(), size_(slot->size), stride_(slot->stride)
+{
+    if (slot_->mapped) {
+        LOGTHROW(err2, Error)
+            << "Readback frame " << slot_->sequence << " already mapped.";
+    }
+
+    state::bindBuffer(GL_PIXEL_PACK_BUFFER, slot_->buffer);
+    data_ = ::glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size_
+                               , GL_MAP_READ_BIT);
+    state::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!data_) {
+        LOGTHROW(err2, Error)
+            << "Cannot map readback buffer of frame "
+            << slot_->sequence << ".";
+    }
+    slot_->mapped = true;
+}
+
+Readback::Mapping::~Mapping()
+{
+    unmap();
+}
+
+Readback::Mapping& Readback::Mapping::operator=(Mapping &&other)
+{
+    if (this == &other) { return *this; }
+
+    unmap();
+    slot_ = std::move(other.slot_);
+    data_ = other.data_;
+    size_ = other.size_;
+    stride_ = other.stride_;
+
+    other.slot_.reset();
+    other.data_ = nullptr;
+    return *this;
+}
+
+void Readback::Mapping::unmap()
+{
+    // moved-from
+    if (!slot_) { return; }
+
+    state::bindBuffer(GL_PIXEL_PACK_BUFFER, slot_->buffer);
+    ::glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    state::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot_->mapped = false;
+    slot_.reset();
+}
+
+} // namespace glsupport
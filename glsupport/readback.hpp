@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef readback_hpp_included_
+#define readback_hpp_included_
+
+#include <memory>
+#include <vector>
+
+#include "utility/gl.hpp"
+
+#include "./fb.hpp"
+#include "./sync.hpp"
+
+namespace glsupport {
+
+/** Asynchronous framebuffer readback.
+ *
+ *  Color buffer content is read into a ring of pixel buffer objects, each
+ *  guarded by a fence. Readback of frame K can be consumed while frame K+1 is
+ *  being rendered.
+ *
+ *  Usage:
+ *      Readback rb(fb);
+ *      render(0); auto f0(rb.read());
+ *      render(1); auto f1(rb.read());
+ *      { auto m(f0.map()); consume(m.data(), m.size()); }
+ *      f0 = {};
+ *      ...
+ *
+ *  Frame handles keep their ring slot busy; release them after the data have
+ *  been consumed. Scheduling a read into a busy slot throws.
+ *
+ *  All operations must be performed with GL context current.
+ */
+class Readback {
+public:
+    class Frame;
+    class Mapping;
+
+    /** Creates readback ring for given framebuffer. Framebuffer must outlive
+     *  this object.
+     *
+     * \param fb framebuffer to read from
+     * \param depth number of slots in the ring
+     * \param attachment index of color attachment to read
+     */
+    Readback(const FrameBuffer &fb, std::size_t depth = 3
+             , std::size_t attachment = 0);
+
+    Readback(const Readback&) = delete;
+    Readback& operator=(const Readback&) = delete;
+
+    /** Schedules readback of framebuffer's current color attachment content.
+     *  Multisampled framebuffer is resolved first. Does not block.
+     */
+    Frame read();
+
+    std::size_t depth() const { return slots_.size(); }
+    std::size_t attachment() const { return attachment_; }
+
+private:
+    struct Slot;
+
+    const FrameBuffer &fb_;
+    const std::size_t attachment_;
+    std::vector<std::shared_ptr<Slot>> slots_;
+    std::size_t next_;
+    std::size_t sequence_;
+};
+
+/** Poll handle for single scheduled readback.
+ */
+class Readback::Frame {
+public:
+    Frame() {}
+
+    /** Non-blocking check whether data are available. Empty frame is
+     *  always ready.
+     */
+    bool ready() const;
+
+    /** Waits until data are available. No-op for empty frame.
+     */
+    void wait() const;
+
+    /** Maps read data into client memory. Waits until data are available.
+     *  Throws for empty frame.
+     */
+    Mapping map() const;
+
+    /** Sequence number of this readback. Throws for empty frame.
+     */
+    std::size_t sequence() const;
+
+    explicit operator bool() const { return bool(slot_); }
+
+private:
+    friend class Readback;
+    Frame(const std::shared_ptr<Slot> &slot) : slot_(slot) {}
+
+    std::shared_ptr<Slot> slot_;
+};
+
+/** Read-only view into mapped pixel buffer. Rows are tightly packed,
+ *  bottom-up. Buffer is unmapped when last mapping goes away.
+ */
+class Readback::Mapping {
+public:
+    Mapping(Mapping&&) = default;
+    Mapping& operator=(Mapping &&other);
+    ~Mapping();
+
+    const void* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    /** Row stride in bytes.
+     */
+    std::size_t stride() const { return stride_; }
+
+private:
+    friend class Frame;
+    Mapping(const std::shared_ptr<Slot> &slot);
+
+    void unmap();
+
+    std::shared_ptr<Slot> slot_;
+    const void *data_;
+    std::size_t size_;
+    std::size_t stride_;
+};
+
+} // namespace glsupport
+
+#endif // readback_hpp_included_
@@ -24,7 +24,12 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <iterator>
+
 #include "./shader.hpp"
+#include "./extensions.hpp"
+#include "./debug.hpp"
 
 namespace glsupport {
 
@@ -35,13 +40,17 @@ const char* typeName(::GLenum type)
     switch (type) {
     case GL_VERTEX_SHADER: return "vertex";
     case GL_FRAGMENT_SHADER: return "fragment";
+    case GL_GEOMETRY_SHADER: return "geometry";
+    case GL_TESS_CONTROL_SHADER: return "tessellation control";
+    case GL_TESS_EVALUATION_SHADER: return "tessellation evaluation";
+    case GL_COMPUTE_SHADER: return "compute";
     default: return "unknown";
     }
     return "unknown";
 }
 
-std::shared_ptr< ::GLuint> loadShader(::GLenum type, const void *data
-                                      , std::size_t size)
+std::shared_ptr< ::GLuint> compileShader(::GLenum type, const void *data
+                                         , std::size_t size)
 {
     std::shared_ptr< ::GLuint> shader
         (new ::GLuint(), [](GLuint *shader) -> void {
@@ -61,16 +70,21 @@ std::shared_ptr< ::GLuint> loadShader(::GLenum type, const void *data
 
     ::glCompileShader(*shader);
 
+    return shader;
+}
+
+void checkShader(::GLenum type, ::GLuint shader)
+{
     ::GLint compiled{};
-    ::glGetShaderiv(*shader, GL_COMPILE_STATUS, &compiled);
+    ::glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
 
     if (!compiled) {
         GLint il = 0;
-        ::glGetShaderiv(*shader, GL_INFO_LOG_LENGTH, &il);
+        ::glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &il);
         if (il > 1) {
             std::vector<char> log(il);
 
-            ::glGetShaderInfoLog(*shader, il, nullptr, &log[0]);
+            ::glGetShaderInfoLog(shader, il, nullptr, &log[0]);
             LOGTHROW(err2, Error)
                 << "Cannot compile " << typeName(type) << " shader: "
                 << log.data();
@@ -79,20 +93,97 @@ std::shared_ptr< ::GLuint> loadShader(::GLenum type, const void *data
         LOGTHROW(err2, Error)
             << "Cannot compile " << typeName(type) << " shader.";
     }
+}
 
+std::shared_ptr< ::GLuint> loadShader(::GLenum type, const void *data
+                                      , std::size_t size)
+{
+    auto shader(compileShader(type, data, size));
+    checkShader(type, *shader);
     return shader;
 }
 
+/** Name hash to location mapping, sorted by hash.
+ */
+class LocationTable {
+public:
+    void add(const std::string &name, ::GLint location) {
+        entries_.push_back({ fnv1a(name.c_str()), location, name });
+    }
+
+    void sort() {
+        std::sort(entries_.begin(), entries_.end()
+                  , [](const Entry &l, const Entry &r) {
+                      return l.hash < r.hash;
+                  });
+    }
+
+    ::GLint find(const Name &name, ::GLint notFound) const {
+        auto range(std::equal_range(entries_.begin(), entries_.end()
+                                    , Entry{ name.hash(), 0, {} }
+                                    , [](const Entry &l, const Entry &r) {
+                                        return l.hash < r.hash;
+                                    }));
+        if (range.first == range.second) { return notFound; }
+
+        // resolve hash collision, if any
+        if (std::next(range.first) != range.second) {
+            for (; range.first != range.second; ++range.first) {
+                if (range.first->name == name.name()) {
+                    return range.first->location;
+                }
+            }
+            return notFound;
+        }
+
+        return range.first->location;
+    }
+
+private:
+    struct Entry {
+        std::uint64_t hash;
+        ::GLint location;
+        std::string name;
+    };
+
+    std::vector<Entry> entries_;
+};
+
+struct ProgramInfo {
+    /** Completion status can be polled.
+     */
+    bool pollable;
+
+    /** Link status has been checked.
+     */
+    bool done;
+
+    /** Link error, if any.
+     */
+    std::string error;
+
+    LocationTable uniforms;
+    LocationTable attributes;
+    LocationTable blocks;
+
+    ProgramInfo(bool pollable = false, bool done = true)
+        : pollable(pollable), done(done)
+    {}
+};
+
 } // namespace detail
 
-void Program::link(VertexShader vs, FragmentShader fs
-                   , const Attributes &attributes)
+namespace {
+
+typedef std::shared_ptr< ::GLuint> ProgramPtr;
+
+ProgramPtr createProgram()
 {
     // create invalid program
-    Ptr program(new ::GLuint(0), [](::GLuint *program)
-                {
-                    ::glDeleteProgram(*program);
-                });
+    ProgramPtr program(new ::GLuint(0), [](::GLuint *program)
+                       {
+                           ::glDeleteProgram(*program);
+                       });
 
     // having valid pointer we can safely create program
     *program = ::glCreateProgram();
@@ -101,37 +192,339 @@ void Program::link(VertexShader vs, FragmentShader fs
             << "Cannot create shader.";
     }
 
-    ::glAttachShader(*program, vs);
-    ::glAttachShader(*program, fs);
+    return program;
+}
+
+std::string linkLog(::GLuint program)
+{
+    ::GLint il = 0;
+    ::glGetProgramiv(program, GL_INFO_LOG_LENGTH, &il);
+    if (il <= 1) { return {}; }
+
+    std::vector<char> log;
+    log.resize(il);
+    ::glGetProgramInfoLog(program, il, nullptr, log.data());
+    return log.data();
+}
+
+bool linked(::GLuint program)
+{
+    ::GLint linked{};
+    ::glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked;
+}
+
+void checkLinked(::GLuint program)
+{
+    if (!linked(program)) {
+        const auto log(linkLog(program));
+        if (!log.empty()) {
+            LOGTHROW(err2, Error)
+                << "Cannot link program: " << log;
+        }
+
+        LOGTHROW(err2, Error)
+            << "Cannot link program.";
+    }
+}
+
+bool parallelShaderCompile()
+{
+    return (hasExtension("GL_KHR_parallel_shader_compile")
+            || hasExtension("GL_ARB_parallel_shader_compile"));
+}
+
+} // namespace
+
+namespace {
+
+const char* stageSuffix(::GLenum type)
+{
+    switch (type) {
+    case GL_VERTEX_SHADER: return "vs";
+    case GL_FRAGMENT_SHADER: return "fs";
+    case GL_GEOMETRY_SHADER: return "gs";
+    case GL_TESS_CONTROL_SHADER: return "tcs";
+    case GL_TESS_EVALUATION_SHADER: return "tes";
+    case GL_COMPUTE_SHADER: return "cs";
+    default: break;
+    }
+    return "shader";
+}
+
+/** Array name without trailing "[0]", empty if not an array.
+ */
+std::string arrayBase(const std::string &name)
+{
+    const std::string suffix("[0]");
+    if ((name.size() <= suffix.size())
+        || name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+    {
+        return {};
+    }
+    return name.substr(0, name.size() - suffix.size());
+}
+
+template <typename Location>
+void addArray(detail::LocationTable &table, const std::string &name
+              , ::GLint size, Location location)
+{
+    const auto base(arrayBase(name));
+    if (base.empty()) { return; }
+
+    table.add(base, location(name));
+    for (::GLint i(1); i < size; ++i) {
+        const auto element(base + "[" + std::to_string(i) + "]");
+        table.add(element, location(element));
+    }
+}
+
+void introspect(::GLuint program, detail::ProgramInfo &info)
+{
+    ::GLint count(0), maxLength(0), length(0), size(0);
+    ::GLenum type(0);
+    std::vector<char> buffer;
+
+    auto uniformLocation([&](const std::string &name)
+    {
+        return ::glGetUniformLocation(program, name.c_str());
+    });
+
+    ::glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    ::glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    buffer.resize(maxLength + 1);
+    for (::GLint i(0); i < count; ++i) {
+        ::glGetActiveUniform(program, i, buffer.size(), &length, &size
+                             , &type, buffer.data());
+        const std::string name(buffer.data(), length);
+        const auto location(uniformLocation(name));
+        // uniform block members have no location
+        if (location < 0) { continue; }
+
+        info.uniforms.add(name, location);
+        addArray(info.uniforms, name, size, uniformLocation);
+    }
+
+    auto attributeLocation([&](const std::string &name)
+    {
+        return ::glGetAttribLocation(program, name.c_str());
+    });
+
+    ::glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    ::glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    buffer.resize(maxLength + 1);
+    for (::GLint i(0); i < count; ++i) {
+        ::glGetActiveAttrib(program, i, buffer.size(), &length, &size
+                            , &type, buffer.data());
+        const std::string name(buffer.data(), length);
+        const auto location(attributeLocation(name));
+        // built-in attributes have no location
+        if (location < 0) { continue; }
+
+        info.attributes.add(name, location);
+        addArray(info.attributes, name, size, attributeLocation);
+    }
+
+    ::glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    ::glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH
+                     , &maxLength);
+    buffer.resize(maxLength + 1);
+    for (::GLint i(0); i < count; ++i) {
+        ::glGetActiveUniformBlockName(program, i, buffer.size(), &length
+                                      , buffer.data());
+        const std::string name(buffer.data(), length);
+        info.blocks.add(name, i);
+
+        // block arrays: each element is a separate block
+        const auto base(arrayBase(name));
+        if (!base.empty()) { info.blocks.add(base, i); }
+    }
+
+    info.uniforms.sort();
+    info.attributes.sort();
+    info.blocks.sort();
+}
+
+} // namespace
+
+void Program::submit(const Stages &stages, const Attributes &attributes
+                     , int flags)
+{
+    // resolve() and label() dereference stage shaders
+    for (const auto &stage : stages.stages) {
+        if (!stage.shader) {
+            LOGTHROW(err2, Error)
+                << "Empty shader for stage <"
+                << detail::typeName(stage.type) << ">.";
+        }
+    }
+
+    auto program(createProgram());
+
+    for (const auto &stage : stages.stages) {
+        ::glAttachShader(*program, *stage.shader);
+    }
 
     for (const auto &attr : attributes.attrs) {
         ::glBindAttribLocation(*program, attr.first, attr.second);
     }
 
+    if (flags & LinkFlag::binaryRetrievable) {
+        ::glProgramParameteri(*program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+                              , GL_TRUE);
+    }
+
+    if (flags & LinkFlag::separable) {
+        ::glProgramParameteri(*program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    }
+
     ::glLinkProgram(*program);
 
-    ::GLint linked{};
-    ::glGetProgramiv(*program, GL_LINK_STATUS, &linked);
+    program_ = std::move(program);
+    stages_ = stages.stages;
+    info_.reset();
+    pending_ = false;
+}
 
-    if (!linked) {
-        ::GLint il = 0;
-        ::glGetProgramiv(*program, GL_INFO_LOG_LENGTH, &il);
-        if (il > 1) {
-            std::vector<char> log;
-            log.resize(il);
+void Program::link(const Stages &stages, const Attributes &attributes
+                   , int flags)
+{
+    submit(stages, attributes, flags);
 
-            ::glGetProgramInfoLog(*program, il, nullptr, log.data());
-            LOGTHROW(err2, Error)
-                << "Cannot link program: " << log.data();
+    try {
+        checkLinked(get());
+    } catch (...) {
+        program_.reset();
+        stages_.clear();
+        throw;
+    }
+
+    info_ = std::make_shared<detail::ProgramInfo>();
+    introspect(get(), *info_);
+}
+
+void Program::linkDeferred(const Stages &stages
+                           , const Attributes &attributes, int flags)
+{
+    submit(stages, attributes, flags);
+    info_ = std::make_shared<detail::ProgramInfo>
+        (parallelShaderCompile(), false);
+    pending_ = true;
+}
+
+bool Program::ready() const
+{
+    if (!pending_ || info_->done || !info_->pollable) { return true; }
+
+    ::GLint completed(GL_TRUE);
+    ::glGetProgramiv(get(), GL_COMPLETION_STATUS_KHR, &completed);
+    return completed;
+}
+
+void Program::resolve() const
+{
+    auto &info(*info_);
+    if (!info.done) {
+        info.done = true;
+        try {
+            // report compilation errors first, they make link fail anyway
+            for (const auto &stage : stages_) {
+                detail::checkShader(stage.type, *stage.shader);
+            }
+            checkLinked(get());
+            introspect(get(), info);
+        } catch (const Error &e) {
+            info.error = e.what();
         }
+    }
 
-        LOGTHROW(err2, Error)
-            << "Cannot link program.";
+    // keep failed status in place to report it on every use
+    if (!info.error.empty()) { throw Error(info.error); }
+
+    pending_ = false;
+}
+
+::GLint Program::uniform(const Name &name) const
+{
+    check();
+    return info_ ? info_->uniforms.find(name, -1) : -1;
+}
+
+::GLint Program::attribute(const Name &name) const
+{
+    check();
+    return info_ ? info_->attributes.find(name, -1) : -1;
+}
+
+::GLuint Program::uniformBlock(const Name &name) const
+{
+    check();
+    return (info_ ? info_->blocks.find(name, GL_INVALID_INDEX)
+            : GL_INVALID_INDEX);
+}
+
+bool Program::load(::GLenum format, const void *data, std::size_t size)
+{
+    auto program(createProgram());
+
+    ::glProgramBinary(*program, format, data, ::GLsizei(size));
+
+    if (!linked(*program)) {
+        LOG(info2) << "Program binary rejected by driver ("
+                   << linkLog(*program) << ").";
+        // swallow any error generated by invalid format
+        ::glGetError();
+        return false;
     }
 
     program_ = std::move(program);
-    vs_ = std::move(vs);
-    fs_ = std::move(fs);
+    stages_.clear();
+    info_ = std::make_shared<detail::ProgramInfo>();
+    pending_ = false;
+    introspect(get(), *info_);
+    return true;
+}
+
+std::vector<char> Program::binary(::GLenum &format) const
+{
+    ::GLint length(0);
+    ::glGetProgramiv(get(), GL_PROGRAM_BINARY_LENGTH, &length);
+
+    std::vector<char> data(length);
+    if (!length) { return data; }
+
+    ::GLsizei written(0);
+    ::glGetProgramBinary(get(), length, &written, &format, data.data());
+    data.resize(written);
+    return data;
+}
+
+void Program::label(const std::string &name) const
+{
+    if (!objectLabels()) { return; }
+    objectLabel(GL_PROGRAM, get(), name);
+    for (const auto &stage : stages_) {
+        objectLabel(GL_SHADER, *stage.shader
+                    , name + "." + stageSuffix(stage.type));
+    }
+}
+
+::GLbitfield Program::stageBits() const
+{
+    ::GLbitfield bits(0);
+    for (const auto &stage : stages_) {
+        switch (stage.type) {
+        case GL_VERTEX_SHADER: bits |= GL_VERTEX_SHADER_BIT; break;
+        case GL_FRAGMENT_SHADER: bits |= GL_FRAGMENT_SHADER_BIT; break;
+        case GL_GEOMETRY_SHADER: bits |= GL_GEOMETRY_SHADER_BIT; break;
+        case GL_TESS_CONTROL_SHADER:
+            bits |= GL_TESS_CONTROL_SHADER_BIT; break;
+        case GL_TESS_EVALUATION_SHADER:
+            bits |= GL_TESS_EVALUATION_SHADER_BIT; break;
+        case GL_COMPUTE_SHADER: bits |= GL_COMPUTE_SHADER_BIT; break;
+        }
+    }
+    return bits;
 }
 
 } // namespace glsupport
@@ -28,22 +28,60 @@
 #define shader_hpp_included_
 
 #include <memory>
+#include <vector>
 
 #include "utility/gl.hpp"
 
 #include "dbglog/dbglog.hpp"
 
-namespace glsupport {
+#include "./glerror.hpp"
+#include "./hash.hpp"
+#include "./statecache.hpp"
 
-struct Error : std::runtime_error {
-    Error(const std::string &msg) : std::runtime_error(msg) {}
-};
+namespace glsupport {
 
 namespace detail {
 std::shared_ptr< ::GLuint> loadShader(::GLenum type, const void *data
                                       , std::size_t size);
+
+/** Compiles shader without querying compilation status.
+ */
+std::shared_ptr< ::GLuint> compileShader(::GLenum type, const void *data
+                                         , std::size_t size);
+
+/** Throws if given shader failed to compile.
+ */
+void checkShader(::GLenum type, ::GLuint shader);
+
+/** Shader attached to program.
+ */
+struct ShaderStage {
+    ::GLenum type;
+    std::shared_ptr< ::GLuint> shader;
+};
+
+struct ProgramInfo;
 } // namespace detail
 
+/** Pre-hashed uniform/attribute/uniform block name.
+ *
+ *  Declare as constexpr to hash the name at compile time:
+ *
+ *      constexpr Name color("color");
+ *      ::glUniform4fv(program.uniform(color), 1, c);
+ */
+class Name {
+public:
+    constexpr Name(const char *name) : name_(name), hash_(fnv1a(name)) {}
+
+    constexpr const char* name() const { return name_; }
+    constexpr std::uint64_t hash() const { return hash_; }
+
+private:
+    const char *name_;
+    std::uint64_t hash_;
+};
+
 template < ::GLenum Type>
 class Shader {
 public:
@@ -67,9 +105,23 @@ public:
         load(data, size * sizeof(T));
     }
 
+    /** Compiles shader without waiting for the result. Compilation status
+     *  is checked by program this shader is linked into.
+     */
+    static Shader deferred(const std::string &src) {
+        Shader shader;
+        shader.shader_ = detail::compileShader(type, src.data()
+                                               , src.length());
+        return shader;
+    }
+
     GLuint get() const { return shader_ ? *shader_ : 0; }
     operator GLuint() const { return get(); }
 
+    /** This shader as a program stage.
+     */
+    detail::ShaderStage stage() const { return { Type, shader_ }; }
+
 private:
     void load(const void *data, std::size_t size) {
         shader_ = detail::loadShader(type, data, size);
@@ -81,47 +133,159 @@ private:
 
 typedef Shader<GL_VERTEX_SHADER> VertexShader;
 typedef Shader<GL_FRAGMENT_SHADER> FragmentShader;
+typedef Shader<GL_GEOMETRY_SHADER> GeometryShader;
+typedef Shader<GL_TESS_CONTROL_SHADER> TessControlShader;
+typedef Shader<GL_TESS_EVALUATION_SHADER> TessEvaluationShader;
+typedef Shader<GL_COMPUTE_SHADER> ComputeShader;
 
 class Program {
 public:
     struct Attributes;
+    struct Stages;
+
+    /** Link flags.
+     */
+    enum LinkFlag : int {
+        /** Hint driver that program binary will be retrieved.
+         */
+        binaryRetrievable = 0x1
 
-    Program() {}
+        /** Program can be bound to individual stages of program pipeline
+         *  (GL_PROGRAM_SEPARABLE), see ProgramPipeline.
+         */
+        , separable = 0x2
+    };
+
+    Program() : pending_(false) {}
 
     void link(VertexShader vs, FragmentShader fs);
 
     void link(VertexShader vs, FragmentShader fs
-              , const Attributes &attributes);
+              , const Attributes &attributes, int flags = 0);
+
+    /** Links arbitrary set of stages, e.g. compute shader alone or
+     *  vertex + geometry + fragment shader:
+     *
+     *      program.link(cs);
+     *      program.link(Program::Stages(vs)(gs)(fs));
+     */
+    void link(const Stages &stages);
+
+    void link(const Stages &stages, const Attributes &attributes
+              , int flags = 0);
+
+    /** Links program without waiting for the result. Link status (and
+     *  status of both shaders) is checked on first use, i.e. by use(),
+     *  uniform(), attribute() or explicit check().
+     */
+    void linkDeferred(VertexShader vs, FragmentShader fs);
+
+    void linkDeferred(VertexShader vs, FragmentShader fs
+                      , const Attributes &attributes, int flags = 0);
+
+    void linkDeferred(const Stages &stages, const Attributes &attributes
+                      , int flags = 0);
+
+    /** Non-blocking check whether deferred link has finished. Polls
+     *  GL_COMPLETION_STATUS when parallel shader compilation is supported,
+     *  otherwise always true.
+     */
+    bool ready() const;
+
+    /** Checks result of deferred link, throws on failure.
+     */
+    void check() const { if (pending_) { resolve(); } }
+
+    /** Loads program from binary previously obtained via binary().
+     *
+     * \return false if driver rejected the binary
+     */
+    bool load(::GLenum format, const void *data, std::size_t size);
+
+    /** Retrieves program binary. Program should be linked with
+     *  binaryRetrievable flag.
+     *
+     * \param format binary format (output)
+     * \return binary data, empty if driver provides none
+     */
+    std::vector<char> binary(::GLenum &format) const;
 
     ::GLuint get() const { return program_ ? *program_ : 0; }
     operator ::GLuint() const { return get(); }
 
-    void use() const { ::glUseProgram(get()); }
+    /** Pipeline stage bits (GL_VERTEX_SHADER_BIT...) of linked stages; 0
+     *  for program loaded from binary.
+     */
+    ::GLbitfield stageBits() const;
+
+    void use() const { check(); state::useProgram(get()); }
 
-    void stop() const { ::glUseProgram(0); }
+    /** Labels program and its shaders (<name>.vs, <name>.fs...) for GL
+     *  debug output and debuggers, see objectLabel().
+     */
+    void label(const std::string &name) const;
+
+    void stop() const { state::useProgram(0); }
+
+    /** Location of active uniform, -1 if there is no such uniform.
+     *
+     *  Locations of all active uniforms, attributes and uniform blocks are
+     *  collected once after link; lookups never hit the driver. Lookup by
+     *  Name involves no string hashing.
+     */
+    ::GLint uniform(const Name &name) const;
 
     ::GLint uniform(const char *name) const {
-        return ::glGetUniformLocation(get(), name);
+        return uniform(Name(name));
     }
 
     ::GLint uniform(const std::string &name) const {
         return uniform(name.c_str());
     }
 
+    /** Location of active attribute, -1 if there is no such attribute.
+     */
+    ::GLint attribute(const Name &name) const;
+
     ::GLint attribute(const char *name) const {
-        return ::glGetAttribLocation(get(), name);
+        return attribute(Name(name));
     }
 
     ::GLint attribute(const std::string &name) const {
         return attribute(name.c_str());
     }
 
+    /** Index of active uniform block, GL_INVALID_INDEX if there is no such
+     *  block.
+     */
+    ::GLuint uniformBlock(const Name &name) const;
+
+    ::GLuint uniformBlock(const char *name) const {
+        return uniformBlock(Name(name));
+    }
+
+    ::GLuint uniformBlock(const std::string &name) const {
+        return uniformBlock(name.c_str());
+    }
+
 private:
-    VertexShader vs_;
-    FragmentShader fs_;
+    void submit(const Stages &stages, const Attributes &attributes
+                , int flags);
+
+    void resolve() const;
+
+    std::vector<detail::ShaderStage> stages_;
 
     typedef std::shared_ptr< ::GLuint> Ptr;
     Ptr program_;
+
+    /** Link status and location tables, shared between copies.
+     */
+    std::shared_ptr<detail::ProgramInfo> info_;
+
+    /** Link status not checked yet by this copy.
+     */
+    mutable bool pending_;
 };
 
 struct Program::Attributes {
@@ -141,6 +305,23 @@ struct Program::Attributes {
     }
 };
 
+struct Program::Stages {
+    std::vector<detail::ShaderStage> stages;
+
+    Stages() {}
+
+    template < ::GLenum Type>
+    Stages(const Shader<Type> &shader) {
+        stages.push_back(shader.stage());
+    }
+
+    template < ::GLenum Type>
+    Stages& operator()(const Shader<Type> &shader) {
+        stages.push_back(shader.stage());
+        return *this;
+    }
+};
+
 // inlines
 
 inline void Program::link(VertexShader vs, FragmentShader fs)
@@ -148,6 +329,28 @@ inline void Program::link(VertexShader vs, FragmentShader fs)
     return link(vs, fs, {});
 }
 
+inline void Program::link(VertexShader vs, FragmentShader fs
+                          , const Attributes &attributes, int flags)
+{
+    return link(Stages(vs)(fs), attributes, flags);
+}
+
+inline void Program::link(const Stages &stages)
+{
+    return link(stages, {});
+}
+
+inline void Program::linkDeferred(VertexShader vs, FragmentShader fs)
+{
+    return linkDeferred(vs, fs, {});
+}
+
+inline void Program::linkDeferred(VertexShader vs, FragmentShader fs
+                                  , const Attributes &attributes, int flags)
+{
+    return linkDeferred(Stages(vs)(fs), attributes, flags);
+}
+
 } // namespace glsupport
 
 #endif // shader_hpp_included_
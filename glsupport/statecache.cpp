@@ -0,0 +1,715 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dbglog/dbglog.hpp"
+
+#include "./statecache.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Number of tracked texture units.
+ */
+constexpr ::GLuint maxUnits(32);
+
+thread_local StateCache *current_(nullptr);
+
+template <typename T>
+struct Tracked {
+    T value;
+    bool known;
+
+    Tracked() : value(), known(false) {}
+
+    /** Stores value; returns false when it is already known.
+     */
+    bool set(const T &v) {
+        if (known && (value == v)) { return false; }
+        value = v;
+        known = true;
+        return true;
+    }
+
+    /** Replaces known value (GL unbinds deleted objects).
+     */
+    void replace(const T &from, const T &to) {
+        if (known && (value == from)) { value = to; }
+    }
+};
+
+const ::GLenum textureTargets[] = {
+    GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_2D_MULTISAMPLE
+    , GL_TEXTURE_CUBE_MAP
+};
+
+const ::GLenum textureBindings[] = {
+    GL_TEXTURE_BINDING_2D, GL_TEXTURE_BINDING_2D_ARRAY
+    , GL_TEXTURE_BINDING_2D_MULTISAMPLE, GL_TEXTURE_BINDING_CUBE_MAP
+};
+
+const ::GLenum bufferTargets[] = {
+    GL_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER
+    , GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_DRAW_INDIRECT_BUFFER
+};
+
+const ::GLenum bufferBindings[] = {
+    GL_ARRAY_BUFFER_BINDING, GL_PIXEL_PACK_BUFFER_BINDING
+    , GL_PIXEL_UNPACK_BUFFER_BINDING, GL_COPY_READ_BUFFER_BINDING
+    , GL_COPY_WRITE_BUFFER_BINDING, GL_DRAW_INDIRECT_BUFFER_BINDING
+};
+
+const ::GLenum capabilities[] = {
+    GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST
+};
+
+constexpr std::size_t textureTargetCount
+    = sizeof(textureTargets) / sizeof(textureTargets[0]);
+constexpr std::size_t bufferTargetCount
+    = sizeof(bufferTargets) / sizeof(bufferTargets[0]);
+constexpr std::size_t capabilityCount
+    = sizeof(capabilities) / sizeof(capabilities[0]);
+
+template <std::size_t N>
+int indexOf(const ::GLenum (&list)[N], ::GLenum value)
+{
+    for (std::size_t i(0); i < N; ++i) {
+        if (list[i] == value) { return int(i); }
+    }
+    return -1;
+}
+
+::GLuint getUint(::GLenum name)
+{
+    ::GLint value(0);
+    ::glGetIntegerv(name, &value);
+    return value;
+}
+
+const char* kindName(StateCache::Kind kind)
+{
+    typedef StateCache::Kind Kind;
+    switch (kind) {
+    case Kind::program: return "program";
+    case Kind::framebuffer: return "framebuffer";
+    case Kind::activeTexture: return "active texture";
+    case Kind::texture: return "texture";
+    case Kind::vertexArray: return "vertex array";
+    case Kind::buffer: return "buffer";
+    case Kind::viewport: return "viewport";
+    case Kind::capability: return "capability";
+    case Kind::blend: return "blend";
+    case Kind::depth: return "depth";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+struct StateCache::State {
+    typedef std::array<Tracked< ::GLuint>, textureTargetCount> UnitTextures;
+
+    Tracked< ::GLuint> program;
+    Tracked< ::GLuint> drawFramebuffer;
+    Tracked< ::GLuint> readFramebuffer;
+    Tracked< ::GLuint> activeTexture;
+    std::array<UnitTextures, maxUnits> textures;
+    Tracked< ::GLuint> vertexArray;
+    std::array<Tracked< ::GLuint>, bufferTargetCount> buffers;
+    Tracked<std::array< ::GLint, 4> > viewport;
+    std::array<Tracked<bool>, capabilityCount> capabilities;
+    Tracked<std::array< ::GLenum, 4> > blend;
+    Tracked< ::GLenum> depthFunc;
+    Tracked<bool> depthMask;
+
+    /** Texture binding of given target on active unit, nullptr when not
+     *  tracked.
+     */
+    Tracked< ::GLuint>* texture(::GLenum target) {
+        const auto index(indexOf(textureTargets, target));
+        if (!activeTexture.known || (activeTexture.value >= maxUnits)
+            || (index < 0))
+        {
+            return nullptr;
+        }
+        return &textures[activeTexture.value][index];
+    }
+
+    Tracked< ::GLuint>* buffer(::GLenum target) {
+        const auto index(indexOf(bufferTargets, target));
+        return (index < 0) ? nullptr : &buffers[index];
+    }
+};
+
+struct StateAccess {
+    typedef StateCache::Kind Kind;
+    typedef StateCache::State State;
+
+    /** State of current cache, nullptr if there is no current cache.
+     */
+    static StateCache::State* state() {
+        return current_ ? current_->state_.get() : nullptr;
+    }
+
+    /** Counts call through current cache, returns whether it is needed.
+     */
+    static bool count(Kind kind, bool needed) {
+        auto &counter(current_->counters_[std::size_t(kind)]);
+        ++counter.calls;
+        if (!needed) { ++counter.redundant; }
+        return needed;
+    }
+
+    /** Stores value in current cache (if any) and tells whether GL call
+     *  is needed.
+     */
+    template <typename T>
+    static bool filter(Kind kind, Tracked<T> State::*member
+                       , const T &value)
+    {
+        auto *s(state());
+        if (!s) { return true; }
+        return count(kind, (s->*member).set(value));
+    }
+};
+
+typedef StateCache::Kind Kind;
+
+StateCache::StateCache()
+    : state_(new State())
+{}
+
+StateCache::~StateCache()
+{
+    if (current_ == this) { current_ = nullptr; }
+}
+
+void StateCache::invalidate()
+{
+    *state_ = State();
+}
+
+StateCache::Snapshot StateCache::save() const
+{
+    Snapshot snapshot;
+    snapshot.state_ = std::make_shared<const State>(*state_);
+    return snapshot;
+}
+
+void StateCache::restore(const Snapshot &snapshot)
+{
+    if (!snapshot.state_) { return; }
+    const auto &s(*snapshot.state_);
+
+    // everything unknown -> every known value is applied
+    Scope scope(*this);
+    invalidate();
+
+    if (s.program.known) { state::useProgram(s.program.value); }
+    if (s.drawFramebuffer.known) {
+        state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, s.drawFramebuffer.value);
+    }
+    if (s.readFramebuffer.known) {
+        state::bindFramebuffer(GL_READ_FRAMEBUFFER, s.readFramebuffer.value);
+    }
+    if (s.vertexArray.known) { state::bindVertexArray(s.vertexArray.value); }
+
+    for (std::size_t i(0); i < bufferTargetCount; ++i) {
+        if (s.buffers[i].known) {
+            state::bindBuffer(bufferTargets[i], s.buffers[i].value);
+        }
+    }
+
+    for (::GLuint unit(0); unit < maxUnits; ++unit) {
+        for (std::size_t i(0); i < textureTargetCount; ++i) {
+            const auto &texture(s.textures[unit][i]);
+            if (texture.known) {
+                state::bindTexture(unit, textureTargets[i], texture.value);
+            }
+        }
+    }
+    if (s.activeTexture.known) {
+        state::activeTexture(s.activeTexture.value);
+    } else {
+        // bindTexture above activated some unit
+        state_->activeTexture = {};
+    }
+
+    if (s.viewport.known) {
+        const auto &v(s.viewport.value);
+        state::viewport(v[0], v[1], v[2], v[3]);
+    }
+
+    for (std::size_t i(0); i < capabilityCount; ++i) {
+        if (s.capabilities[i].known) {
+            state::enable(capabilities[i], s.capabilities[i].value);
+        }
+    }
+
+    if (s.blend.known) {
+        const auto &b(s.blend.value);
+        state::blendFuncSeparate(b[0], b[1], b[2], b[3]);
+    }
+    if (s.depthFunc.known) { state::depthFunc(s.depthFunc.value); }
+    if (s.depthMask.known) { state::depthMask(s.depthMask.value); }
+}
+
+StateCache::Counter StateCache::total() const
+{
+    Counter total;
+    for (const auto &counter : counters_) {
+        total.calls += counter.calls;
+        total.redundant += counter.redundant;
+    }
+    return total;
+}
+
+void StateCache::log() const
+{
+    const auto percent([](const Counter &c) {
+        return c.calls ? (100.0 * c.redundant / c.calls) : 0.0;
+    });
+
+    for (std::size_t i(0); i < kinds; ++i) {
+        const auto &c(counters_[i]);
+        if (!c.calls) { continue; }
+        LOG(info3) << "GL state cache <" << kindName(Kind(i)) << ">: "
+                   << c.calls << " calls, " << c.redundant
+                   << " redundant (" << percent(c) << " %).";
+    }
+
+    const auto t(total());
+    LOG(info3) << "GL state cache total: " << t.calls << " calls, "
+               << t.redundant << " redundant (" << percent(t) << " %).";
+}
+
+StateCache* StateCache::current()
+{
+    return current_;
+}
+
+StateCache::Scope::Scope(StateCache &cache)
+    : previous_(current_)
+{
+    current_ = &cache;
+}
+
+StateCache::Scope::~Scope()
+{
+    current_ = previous_;
+}
+
+namespace state {
+
+void useProgram(::GLuint program)
+{
+    if (StateAccess::filter(Kind::program, &StateAccess::State::program
+                            , program))
+    {
+        ::glUseProgram(program);
+    }
+}
+
+void bindFramebuffer(::GLenum target, ::GLuint framebuffer)
+{
+    if (auto *s = StateAccess::state()) {
+        bool needed(false);
+        if (target != GL_READ_FRAMEBUFFER) {
+            needed |= s->drawFramebuffer.set(framebuffer);
+        }
+        if (target != GL_DRAW_FRAMEBUFFER) {
+            needed |= s->readFramebuffer.set(framebuffer);
+        }
+        if (!StateAccess::count(Kind::framebuffer, needed)) { return; }
+    }
+    ::glBindFramebuffer(target, framebuffer);
+}
+
+void activeTexture(::GLuint unit)
+{
+    if (StateAccess::filter(Kind::activeTexture
+                            , &StateAccess::State::activeTexture, unit))
+    {
+        ::glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void bindTexture(::GLenum target, ::GLuint texture)
+{
+    if (auto *s = StateAccess::state()) {
+        auto *tracked(s->texture(target));
+        if (!StateAccess::count(Kind::texture
+                                , !tracked || tracked->set(texture)))
+        {
+            return;
+        }
+    }
+    ::glBindTexture(target, texture);
+}
+
+void bindTexture(::GLuint unit, ::GLenum target, ::GLuint texture)
+{
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void bindVertexArray(::GLuint vertexArray)
+{
+    if (StateAccess::filter(Kind::vertexArray
+                            , &StateAccess::State::vertexArray, vertexArray))
+    {
+        ::glBindVertexArray(vertexArray);
+    }
+}
+
+void bindBuffer(::GLenum target, ::GLuint buffer)
+{
+    if (auto *s = StateAccess::state()) {
+        auto *tracked(s->buffer(target));
+        if (!StateAccess::count(Kind::buffer
+                                , !tracked || tracked->set(buffer)))
+        {
+            return;
+        }
+    }
+    ::glBindBuffer(target, buffer);
+}
+
+void viewport(::GLint x, ::GLint y, ::GLsizei width, ::GLsizei height)
+{
+    if (StateAccess::filter(Kind::viewport, &StateAccess::State::viewport
+                            , std::array< ::GLint, 4>
+                            {{ x, y, width, height }}))
+    {
+        ::glViewport(x, y, width, height);
+    }
+}
+
+void enable(::GLenum capability, bool enabled)
+{
+    if (auto *s = StateAccess::state()) {
+        const auto index(indexOf(capabilities, capability));
+        if (!StateAccess::count(Kind::capability
+                                , ((index < 0)
+                                   || s->capabilities[index].set(enabled))))
+        {
+            return;
+        }
+    }
+
+    if (enabled) {
+        ::glEnable(capability);
+    } else {
+        ::glDisable(capability);
+    }
+}
+
+void blendFunc(::GLenum src, ::GLenum dst)
+{
+    if (StateAccess::filter(Kind::blend, &StateAccess::State::blend
+                            , std::array< ::GLenum, 4>
+                            {{ src, dst, src, dst }}))
+    {
+        ::glBlendFunc(src, dst);
+    }
+}
+
+void blendFuncSeparate(::GLenum srcRgb, ::GLenum dstRgb
+                       , ::GLenum srcAlpha, ::GLenum dstAlpha)
+{
+    if (StateAccess::filter(Kind::blend, &StateAccess::State::blend
+                            , std::array< ::GLenum, 4>
+                            {{ srcRgb, dstRgb, srcAlpha, dstAlpha }}))
+    {
+        ::glBlendFuncSeparate(srcRgb, dstRgb, srcAlpha, dstAlpha);
+    }
+}
+
+void depthFunc(::GLenum func)
+{
+    if (StateAccess::filter(Kind::depth, &StateAccess::State::depthFunc
+                            , func))
+    {
+        ::glDepthFunc(func);
+    }
+}
+
+void depthMask(bool mask)
+{
+    if (StateAccess::filter(Kind::depth, &StateAccess::State::depthMask
+                            , mask))
+    {
+        ::glDepthMask(mask ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void deleteTextures(::GLsizei count, const ::GLuint *textures)
+{
+    ::glDeleteTextures(count, textures);
+    auto *s(StateAccess::state());
+    if (!s) { return; }
+
+    for (const auto *t(textures), *e(textures + count); t != e; ++t) {
+        if (!*t) { continue; }
+        for (auto &unit : s->textures) {
+            for (auto &texture : unit) { texture.replace(*t, 0); }
+        }
+    }
+}
+
+void deleteFramebuffers(::GLsizei count, const ::GLuint *framebuffers)
+{
+    ::glDeleteFramebuffers(count, framebuffers);
+    auto *s(StateAccess::state());
+    if (!s) { return; }
+
+    for (const auto *f(framebuffers), *e(framebuffers + count); f != e; ++f)
+    {
+        if (!*f) { continue; }
+        s->drawFramebuffer.replace(*f, 0);
+        s->readFramebuffer.replace(*f, 0);
+    }
+}
+
+void deleteBuffers(::GLsizei count, const ::GLuint *buffers)
+{
+    ::glDeleteBuffers(count, buffers);
+    auto *s(StateAccess::state());
+    if (!s) { return; }
+
+    for (const auto *b(buffers), *e(buffers + count); b != e; ++b) {
+        if (!*b) { continue; }
+        for (auto &buffer : s->buffers) { buffer.replace(*b, 0); }
+    }
+}
+
+void deleteVertexArrays(::GLsizei count, const ::GLuint *vertexArrays)
+{
+    ::glDeleteVertexArrays(count, vertexArrays);
+    auto *s(StateAccess::state());
+    if (!s) { return; }
+
+    for (const auto *v(vertexArrays), *e(vertexArrays + count); v != e; ++v)
+    {
+        if (*v) { s->vertexArray.replace(*v, 0); }
+    }
+}
+
+::GLuint program()
+{
+    auto *s(StateAccess::state());
+    if (s && s->program.known) { return s->program.value; }
+
+    const auto value(getUint(GL_CURRENT_PROGRAM));
+    if (s) { s->program.set(value); }
+    return value;
+}
+
+::GLuint framebuffer(::GLenum target)
+{
+    const bool draw(target != GL_READ_FRAMEBUFFER);
+    auto *s(StateAccess::state());
+    auto *tracked(s ? (draw ? &s->drawFramebuffer : &s->readFramebuffer)
+                  : nullptr);
+    if (tracked && tracked->known) { return tracked->value; }
+
+    const auto value(getUint(draw ? GL_DRAW_FRAMEBUFFER_BINDING
+                             : GL_READ_FRAMEBUFFER_BINDING));
+    if (tracked) { tracked->set(value); }
+    return value;
+}
+
+::GLuint activeTexture()
+{
+    auto *s(StateAccess::state());
+    if (s && s->activeTexture.known) { return s->activeTexture.value; }
+
+    const auto value(getUint(GL_ACTIVE_TEXTURE) - GL_TEXTURE0);
+    if (s) { s->activeTexture.set(value); }
+    return value;
+}
+
+::GLuint texture(::GLenum target)
+{
+    const auto index(indexOf(textureTargets, target));
+    if (index < 0) {
+        LOGTHROW(err2, Error)
+            << "Texture target 0x" << std::hex << target << std::dec
+            << " is not supported.";
+    }
+
+    // makes active unit known
+    activeTexture();
+
+    auto *s(StateAccess::state());
+    auto *tracked(s ? s->texture(target) : nullptr);
+    if (tracked && tracked->known) { return tracked->value; }
+
+    const auto value(getUint(textureBindings[index]));
+    if (tracked) { tracked->set(value); }
+    return value;
+}
+
+::GLuint vertexArray()
+{
+    auto *s(StateAccess::state());
+    if (s && s->vertexArray.known) { return s->vertexArray.value; }
+
+    const auto value(getUint(GL_VERTEX_ARRAY_BINDING));
+    if (s) { s->vertexArray.set(value); }
+    return value;
+}
+
+::GLuint buffer(::GLenum target)
+{
+    const auto index(indexOf(bufferTargets, target));
+    if (index < 0) {
+        switch (target) {
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return getUint(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+        case GL_UNIFORM_BUFFER:
+            return getUint(GL_UNIFORM_BUFFER_BINDING);
+        default: break;
+        }
+
+        LOGTHROW(err2, Error)
+            << "Buffer target 0x" << std::hex << target << std::dec
+            << " is not supported.";
+    }
+
+    auto *s(StateAccess::state());
+    auto *tracked(s ? s->buffer(target) : nullptr);
+    if (tracked && tracked->known) { return tracked->value; }
+
+    const auto value(getUint(bufferBindings[index]));
+    if (tracked) { tracked->set(value); }
+    return value;
+}
+
+std::array< ::GLint, 4> viewport()
+{
+    auto *s(StateAccess::state());
+    if (s && s->viewport.known) { return s->viewport.value; }
+
+    std::array< ::GLint, 4> value;
+    ::glGetIntegerv(GL_VIEWPORT, value.data());
+    if (s) { s->viewport.set(value); }
+    return value;
+}
+
+} // namespace state
+
+StateGuard::Entry& StateGuard::add(Type type, ::GLenum target)
+{
+    if (count_ == entries_.size()) {
+        LOGTHROW(err2, Error) << "Too many entries in state guard.";
+    }
+
+    auto &entry(entries_[count_++]);
+    entry.type = type;
+    entry.target = target;
+    return entry;
+}
+
+StateGuard& StateGuard::program()
+{
+    add(Type::program).values[0] = state::program();
+    return *this;
+}
+
+StateGuard& StateGuard::framebuffers()
+{
+    add(Type::drawFramebuffer).values[0]
+        = state::framebuffer(GL_DRAW_FRAMEBUFFER);
+    add(Type::readFramebuffer).values[0]
+        = state::framebuffer(GL_READ_FRAMEBUFFER);
+    return *this;
+}
+
+StateGuard& StateGuard::texture(::GLenum target)
+{
+    const auto unit(state::activeTexture());
+    add(Type::activeTexture).values[0] = unit;
+
+    auto &entry(add(Type::texture, target));
+    entry.values[0] = state::texture(target);
+    entry.values[1] = unit;
+    return *this;
+}
+
+StateGuard& StateGuard::vertexArray()
+{
+    add(Type::vertexArray).values[0] = state::vertexArray();
+    return *this;
+}
+
+StateGuard& StateGuard::buffer(::GLenum target)
+{
+    add(Type::buffer, target).values[0] = state::buffer(target);
+    return *this;
+}
+
+StateGuard& StateGuard::viewport()
+{
+    add(Type::viewport).values = state::viewport();
+    return *this;
+}
+
+StateGuard::~StateGuard()
+{
+    while (count_) {
+        const auto &entry(entries_[--count_]);
+        const auto &v(entry.values);
+        switch (entry.type) {
+        case Type::program: state::useProgram(v[0]); break;
+
+        case Type::drawFramebuffer:
+            state::bindFramebuffer(GL_DRAW_FRAMEBUFFER, v[0]);
+            break;
+
+        case Type::readFramebuffer:
+            state::bindFramebuffer(GL_READ_FRAMEBUFFER, v[0]);
+            break;
+
+        case Type::activeTexture: state::activeTexture(v[0]); break;
+
+        case Type::texture:
+            state::bindTexture(v[1], entry.target, v[0]);
+            break;
+
+        case Type::vertexArray: state::bindVertexArray(v[0]); break;
+
+        case Type::buffer: state::bindBuffer(entry.target, v[0]); break;
+
+        case Type::viewport:
+            state::viewport(v[0], v[1], v[2], v[3]);
+            break;
+        }
+    }
+}
+
+} // namespace glsupport
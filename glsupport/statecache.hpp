@@ -0,0 +1,294 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef statecache_hpp_included_
+#define statecache_hpp_included_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include "utility/gl.hpp"
+
+namespace glsupport {
+
+struct StateAccess;
+
+/** Cache of GL binding state of one context.
+ *
+ *  Opt-in. Once a cache is made current in a thread (StateCache::Scope,
+ *  right after its context is made current) all glsupport wrappers route
+ *  their state changes through it (functions in the state namespace below)
+ *  and calls that would change nothing are dropped. Without current cache
+ *  the functions call GL directly.
+ *
+ *  Tracked state: program, draw and read framebuffer, active texture unit,
+ *  2D, 2D array, 2D multisample and cube map bindings of first 32 texture
+ *  units, vertex array, buffer bindings that are not part of VAO state
+ *  (array, pixel pack/unpack, copy read/write, draw indirect), viewport,
+ *  blend/depth test/cull face/scissor test/stencil test enables, blend
+ *  function, depth function and depth mask.
+ *
+ *  Initially everything is unknown and the first call always goes through.
+ *  GL code bypassing the cache (other libraries, raw GL calls) must be
+ *  followed by invalidate() or wrapped by save() and restore(). Objects
+ *  deleted in another context of the share group while bound in this one
+ *  require invalidate() as well.
+ */
+class StateCache {
+public:
+    class Scope;
+    class Snapshot;
+
+    /** Counter categories.
+     */
+    enum class Kind {
+        program, framebuffer, activeTexture, texture, vertexArray, buffer
+        , viewport, capability, blend, depth
+    };
+
+    static constexpr std::size_t kinds = 10;
+
+    struct Counter {
+        /** Calls made through the cache.
+         */
+        std::size_t calls;
+
+        /** Calls dropped as redundant.
+         */
+        std::size_t redundant;
+
+        Counter() : calls(), redundant() {}
+    };
+
+    typedef std::array<Counter, kinds> Counters;
+
+    StateCache();
+    ~StateCache();
+
+    StateCache(const StateCache&) = delete;
+    StateCache& operator=(const StateCache&) = delete;
+
+    /** Forgets all state; use after GL calls that bypassed the cache.
+     */
+    void invalidate();
+
+    /** Saves known state.
+     */
+    Snapshot save() const;
+
+    /** Applies saved state unconditionally (state changed behind cache's
+     *  back is overwritten); state unknown at save time becomes unknown.
+     *  Must be called with cache's context current.
+     */
+    void restore(const Snapshot &snapshot);
+
+    const Counters& counters() const { return counters_; }
+
+    const Counter& counter(Kind kind) const {
+        return counters_[std::size_t(kind)];
+    }
+
+    /** Sum of all counters.
+     */
+    Counter total() const;
+
+    void resetCounters() { counters_ = Counters(); }
+
+    /** Logs counters via dbglog.
+     */
+    void log() const;
+
+    /** Cache current in calling thread, nullptr if none.
+     */
+    static StateCache* current();
+
+private:
+    friend struct StateAccess;
+    struct State;
+
+    std::unique_ptr<State> state_;
+    Counters counters_;
+};
+
+/** Makes cache current in calling thread for the scope's lifetime;
+ *  previously current cache (if any) is reinstated afterwards.
+ */
+class StateCache::Scope {
+public:
+    Scope(StateCache &cache);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    StateCache *previous_;
+};
+
+/** Saved state, see StateCache::save().
+ */
+class StateCache::Snapshot {
+public:
+    Snapshot() {}
+
+private:
+    friend class StateCache;
+
+    std::shared_ptr<const State> state_;
+};
+
+/** State changes routed through current StateCache (if any).
+ */
+namespace state {
+
+void useProgram(::GLuint program);
+
+/** GL_FRAMEBUFFER binds both draw and read framebuffer.
+ */
+void bindFramebuffer(::GLenum target, ::GLuint framebuffer);
+
+/** Activates texture unit; takes unit index, not GL_TEXTUREi.
+ */
+void activeTexture(::GLuint unit);
+
+/** Binds texture to active unit.
+ */
+void bindTexture(::GLenum target, ::GLuint texture);
+
+/** Activates given unit and binds texture to it.
+ */
+void bindTexture(::GLuint unit, ::GLenum target, ::GLuint texture);
+
+void bindVertexArray(::GLuint vertexArray);
+
+void bindBuffer(::GLenum target, ::GLuint buffer);
+
+void viewport(::GLint x, ::GLint y, ::GLsizei width, ::GLsizei height);
+
+void enable(::GLenum capability, bool enabled = true);
+
+inline void disable(::GLenum capability) { enable(capability, false); }
+
+void blendFunc(::GLenum src, ::GLenum dst);
+
+void blendFuncSeparate(::GLenum srcRgb, ::GLenum dstRgb
+                       , ::GLenum srcAlpha, ::GLenum dstAlpha);
+
+void depthFunc(::GLenum func);
+
+void depthMask(bool mask);
+
+/** Deletion; GL unbinds deleted objects from current context.
+ */
+void deleteTextures(::GLsizei count, const ::GLuint *textures);
+void deleteFramebuffers(::GLsizei count, const ::GLuint *framebuffers);
+void deleteBuffers(::GLsizei count, const ::GLuint *buffers);
+void deleteVertexArrays(::GLsizei count, const ::GLuint *vertexArrays);
+
+/** Queries answered by current cache when it knows the state.
+ */
+::GLuint program();
+
+/** GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER.
+ */
+::GLuint framebuffer(::GLenum target);
+
+/** Active texture unit index.
+ */
+::GLuint activeTexture();
+
+/** Texture bound to given target of active unit.
+ */
+::GLuint texture(::GLenum target);
+
+::GLuint vertexArray();
+
+::GLuint buffer(::GLenum target);
+
+std::array< ::GLint, 4> viewport();
+
+} // namespace state
+
+/** Saves selected state and restores it at scope end, in reverse order.
+ *  Queries go through current cache, therefore cost nothing when the cache
+ *  knows the state.
+ *
+ *  Used by glsupport around its own state changes so that caller's
+ *  bindings are not changed behind its back.
+ *
+ *  Usage:
+ *      StateGuard guard;
+ *      guard.framebuffers().texture(GL_TEXTURE_2D);
+ *      state::bindTexture(GL_TEXTURE_2D, texture);
+ *      ...
+ */
+class StateGuard {
+public:
+    StateGuard() : count_() {}
+    ~StateGuard();
+
+    StateGuard(const StateGuard&) = delete;
+    StateGuard& operator=(const StateGuard&) = delete;
+
+    StateGuard& program();
+
+    /** Both draw and read framebuffer.
+     */
+    StateGuard& framebuffers();
+
+    /** Active texture unit and binding of given target on that unit.
+     *  Code inside the guard must bind only to the active unit.
+     */
+    StateGuard& texture(::GLenum target);
+
+    StateGuard& vertexArray();
+
+    StateGuard& buffer(::GLenum target);
+
+    StateGuard& viewport();
+
+private:
+    enum class Type {
+        program, drawFramebuffer, readFramebuffer, activeTexture, texture
+        , vertexArray, buffer, viewport
+    };
+
+    struct Entry {
+        Type type;
+        ::GLenum target;
+        std::array< ::GLint, 4> values;
+    };
+
+    Entry& add(Type type, ::GLenum target = 0);
+
+    std::array<Entry, 8> entries_;
+    std::size_t count_;
+};
+
+} // namespace glsupport
+
+#endif // statecache_hpp_included_
@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./streambuffer.hpp"
+#include "./extensions.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+
+namespace glsupport {
+
+namespace {
+
+const char* modeName(StreamBuffer::Mode mode)
+{
+    switch (mode) {
+    case StreamBuffer::Mode::automatic: return "automatic";
+    case StreamBuffer::Mode::persistent: return "persistent";
+    case StreamBuffer::Mode::unsynchronized: return "unsynchronized";
+    case StreamBuffer::Mode::orphan: return "orphan";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+::GLsizeiptr StreamBuffer::offsetAlignment(::GLenum target)
+{
+    ::GLint alignment(0);
+    switch (target) {
+    case GL_UNIFORM_BUFFER:
+        ::glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        break;
+
+    case GL_SHADER_STORAGE_BUFFER:
+        ::glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+                        , &alignment);
+        break;
+
+    default: break;
+    }
+
+    return (alignment > 0) ? alignment : 16;
+}
+
+bool StreamBuffer::persistentAvailable()
+{
+    ::GLint major(0), minor(0);
+    ::glGetIntegerv(GL_MAJOR_VERSION, &major);
+    ::glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return (((major << 8) | minor) >= 0x404)
+        || hasExtension("GL_ARB_buffer_storage");
+}
+
+StreamBuffer::StreamBuffer(::GLenum target, ::GLsizeiptr capacity
+                           , Mode mode)
+    : capacity_(capacity), mode_(mode)
+    , alignment_(offsetAlignment(target))
+    , uniformAlignment_((target == GL_UNIFORM_BUFFER) ? alignment_
+                        : offsetAlignment(GL_UNIFORM_BUFFER))
+    , buffer_()
+    , base_(), mapped_(false), written_(), released_(), fenced_()
+{
+    if (capacity_ <= 0) {
+        LOGTHROW(err2, Error)
+            << "Invalid stream buffer capacity " << capacity_ << ".";
+    }
+
+    if (mode_ == Mode::automatic) {
+        mode_ = (persistentAvailable() ? Mode::persistent
+                 : Mode::unsynchronized);
+    }
+
+    ::glGenBuffers(1, &buffer_);
+    state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+
+    if (mode_ == Mode::persistent) {
+        const ::GLbitfield flags(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                                 | GL_MAP_COHERENT_BIT);
+        ::glBufferStorage(GL_COPY_WRITE_BUFFER, capacity_, nullptr, flags);
+        base_ = static_cast<char*>
+            (::glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity_, flags));
+    } else {
+        ::glBufferData(GL_COPY_WRITE_BUFFER, capacity_, nullptr
+                       , GL_STREAM_DRAW);
+    }
+
+    state::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if ((mode_ == Mode::persistent) && !base_) {
+        state::deleteBuffers(1, &buffer_);
+        LOGTHROW(err2, Error) << "Cannot map persistent stream buffer.";
+    }
+
+    try {
+        checkGl("StreamBuffer");
+    } catch (...) {
+        state::deleteBuffers(1, &buffer_);
+        throw;
+    }
+
+    LOG(info1) << "Created stream buffer " << buffer_ << " of "
+               << capacity_ << " bytes (" << modeName(mode_) << ").";
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    // deleting buffer unmaps it as well
+    state::deleteBuffers(1, &buffer_);
+}
+
+StreamBuffer::Allocation
+StreamBuffer::allocate(::GLsizeiptr size, ::GLsizeiptr alignment)
+{
+    if ((size < 0) || (size > capacity_)) {
+        LOGTHROW(err2, Error)
+            << "Cannot allocate " << size << " bytes from stream buffer of "
+            << capacity_ << " bytes.";
+    }
+
+    commit();
+
+    if (!alignment) { alignment = alignment_; }
+
+    const ::GLsizeiptr position(written_ % capacity_);
+    ::GLsizeiptr offset(((position + alignment - 1) / alignment)
+                        * alignment);
+    ::GLsizeiptr padding(offset - position);
+
+    if (offset + size > capacity_) {
+        // wrap around, skip ring's tail
+        offset = 0;
+        padding = capacity_ - position;
+    }
+
+    // padding never holds any data, large allocation after wrap-around
+    // needs just the whole ring
+    const auto needed(std::min<std::uint64_t>(padding + size, capacity_));
+
+    if (mode_ != Mode::orphan) {
+        reserve(needed);
+    } else if ((std::uint64_t(capacity_) - (written_ - released_))
+               < needed)
+    {
+        // storage is full, let the driver provide a fresh one
+        state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        ::glBufferData(GL_COPY_WRITE_BUFFER, capacity_, nullptr
+                       , GL_STREAM_DRAW);
+        state::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        released_ = written_;
+        ++stats_.orphans;
+    }
+
+    written_ += padding + size;
+    if ((written_ - released_) > std::uint64_t(capacity_)) {
+        released_ = written_ - capacity_;
+    }
+
+    ++stats_.allocations;
+    stats_.bytes += size;
+
+    Allocation a;
+    a.offset = offset;
+    a.size = size;
+    a.buffer = buffer_;
+
+    if (mode_ == Mode::persistent) {
+        a.data = base_ + offset;
+    } else if (!size) {
+        a.data = nullptr;
+    } else {
+        // range is not used by GPU: no need for driver synchronization
+        state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        a.data = ::glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size
+                                    , (GL_MAP_WRITE_BIT
+                                       | GL_MAP_INVALIDATE_RANGE_BIT
+                                       | GL_MAP_UNSYNCHRONIZED_BIT));
+        state::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (!a.data) {
+            checkGl("glMapBufferRange");
+            LOGTHROW(err2, Error)
+                << "Cannot map range of stream buffer " << buffer_ << ".";
+        }
+        mapped_ = true;
+    }
+
+    return a;
+}
+
+void StreamBuffer::reserve(std::uint64_t size)
+{
+    while ((std::uint64_t(capacity_) - (written_ - released_)) < size) {
+        if (marks_.empty()) {
+            LOGTHROW(err2, Error)
+                << "Stream buffer of " << capacity_ << " bytes is too "
+                "small: more data allocated without fence().";
+        }
+
+        const auto &mark(marks_.front());
+        if (!mark.fence.signaled()) {
+            ++stats_.waits;
+            mark.fence.wait();
+        }
+        released_ = std::max(released_, mark.written);
+        marks_.pop_front();
+    }
+}
+
+void StreamBuffer::commit()
+{
+    if (!mapped_) { return; }
+    mapped_ = false;
+
+    state::bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+    const auto ok(::glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+    state::bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!ok) {
+        LOG(warn2) << "Stream buffer " << buffer_
+                   << " content lost while mapped.";
+    }
+}
+
+void StreamBuffer::fence()
+{
+    if ((mode_ == Mode::orphan) || (written_ == fenced_)) { return; }
+
+    // release what has already been consumed, keeps fence queue short
+    while (!marks_.empty() && marks_.front().fence.signaled()) {
+        released_ = std::max(released_, marks_.front().written);
+        marks_.pop_front();
+    }
+
+    marks_.push_back({ Fence::insert(), written_ });
+    fenced_ = written_;
+}
+
+} // namespace glsupport
@@ -0,0 +1,209 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef streambuffer_hpp_included_
+#define streambuffer_hpp_included_
+
+#include <cstdint>
+#include <deque>
+
+#include "utility/gl.hpp"
+
+#include "./sync.hpp"
+
+namespace glsupport {
+
+/** Streaming buffer for per-frame dynamic data (vertices, indices, uniform
+ *  blocks...).
+ *
+ *  Single buffer object used as a ring: allocate() hands out consecutive
+ *  ranges (bump allocation) and fence() marks end of a frame. Range is
+ *  reused only after GPU has passed fence of the frame that used it,
+ *  therefore neither the application nor the driver allocate or
+ *  synchronize anything in steady state.
+ *
+ *  Storage modes:
+ *      * persistent: immutable storage (glBufferStorage) mapped once with
+ *        GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT; needs GL 4.4 or
+ *        GL_ARB_buffer_storage
+ *      * unsynchronized: every allocation is mapped by glMapBufferRange
+ *        with GL_MAP_UNSYNCHRONIZED_BIT, fenced as above
+ *      * orphan: no fences; when ring wraps around storage is orphaned
+ *        (glBufferData with null data) and driver provides a fresh one
+ *
+ *  Usage:
+ *      StreamBuffer stream(GL_UNIFORM_BUFFER, 4 << 20);
+ *      for (;;) {
+ *          auto a(stream.allocate(sizeof(uniforms)));
+ *          std::memcpy(a.data, &uniforms, sizeof(uniforms));
+ *          stream.commit();
+ *          ::glBindBufferRange(GL_UNIFORM_BUFFER, 0, a.buffer, a.offset
+ *                              , a.size);
+ *          draw();
+ *          stream.fence();
+ *          swap();
+ *      }
+ *
+ *  Buffer is bound only to GL_COPY_WRITE_BUFFER internally, rendering
+ *  bindings (including VAO's element array buffer) are never touched. All
+ *  operations must be performed with context (of the share group) the
+ *  buffer was created in current.
+ */
+class StreamBuffer {
+public:
+    enum class Mode {
+        /** Persistent if available, unsynchronized otherwise.
+         */
+        automatic, persistent, unsynchronized, orphan
+    };
+
+    /** Allocated range.
+     */
+    struct Allocation {
+        /** Write-only pointer to range's memory, valid until commit().
+         */
+        void *data;
+        ::GLintptr offset;
+        ::GLsizeiptr size;
+        ::GLuint buffer;
+
+        template <typename T> T* as() const { return static_cast<T*>(data); }
+    };
+
+    struct Stats {
+        std::size_t allocations;
+        std::uint64_t bytes;
+
+        /** Number of times allocation had to block on fence (CPU has got
+         *  too far ahead of GPU; buffer is too small).
+         */
+        std::size_t waits;
+
+        /** Number of storage orphanings (orphan mode).
+         */
+        std::size_t orphans;
+
+        Stats() : allocations(), bytes(), waits(), orphans() {}
+    };
+
+    /**
+     * \param target intended buffer target; used only to pick default
+     *               allocation alignment (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+     *               and GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, 16 bytes
+     *               otherwise)
+     * \param capacity buffer size in bytes; must hold data of all frames
+     *                 in flight
+     * \param mode storage mode
+     */
+    StreamBuffer(::GLenum target, ::GLsizeiptr capacity
+                 , Mode mode = Mode::automatic);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /** Allocates range of given size. Commits previous allocation. Blocks
+     *  only when the ring is full of ranges still used by GPU; throws when
+     *  size (plus anything allocated since last fence()) exceeds capacity.
+     *
+     * \param size size in bytes
+     * \param alignment offset alignment, 0 = default for buffer's target
+     */
+    Allocation allocate(::GLsizeiptr size, ::GLsizeiptr alignment = 0);
+
+    /** Finishes writes to last allocation; must be called before GL uses
+     *  the data. No-op in persistent mode.
+     */
+    void commit();
+
+    /** Marks end of frame: everything allocated so far is released once
+     *  GPU finishes commands issued until now.
+     */
+    void fence();
+
+    /** Resolved storage mode.
+     */
+    Mode mode() const { return mode_; }
+
+    ::GLsizeiptr capacity() const { return capacity_; }
+
+    ::GLuint get() const { return buffer_; }
+
+    /** GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT of context the buffer was created
+     *  in, whatever its target.
+     */
+    ::GLsizeiptr uniformAlignment() const { return uniformAlignment_; }
+
+    const Stats& stats() const { return stats_; }
+
+    /** Checks whether persistent mapping is available in current context.
+     */
+    static bool persistentAvailable();
+
+    /** Offset alignment required for binding ranges of given target in
+     *  current context (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT...), 16 bytes
+     *  for targets without such limit.
+     */
+    static ::GLsizeiptr offsetAlignment(::GLenum target);
+
+private:
+    /** Waits until given number of bytes is free.
+     */
+    void reserve(std::uint64_t size);
+
+    struct Mark {
+        Fence fence;
+        std::uint64_t written;
+    };
+
+    const ::GLsizeiptr capacity_;
+    Mode mode_;
+    ::GLsizeiptr alignment_;
+    ::GLsizeiptr uniformAlignment_;
+    ::GLuint buffer_;
+
+    /** Persistent mapping.
+     */
+    char *base_;
+
+    /** Allocation is mapped (non-persistent modes).
+     */
+    bool mapped_;
+
+    /** Total bytes consumed (including padding) and released; ring
+     *  position is written_ % capacity_.
+     */
+    std::uint64_t written_;
+    std::uint64_t released_;
+    std::uint64_t fenced_;
+    std::deque<Mark> marks_;
+
+    Stats stats_;
+};
+
+} // namespace glsupport
+
+#endif // streambuffer_hpp_included_
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dbglog/dbglog.hpp"
+
+#include "./sync.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+Fence Fence::insert(bool flush)
+{
+    auto sync(::glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    if (!sync) {
+        LOGTHROW(err2, Error) << "Cannot create GL fence sync.";
+    }
+
+    if (flush) { ::glFlush(); }
+
+    Fence fence;
+    fence.sync_ = std::make_shared<Sync>(sync, flush);
+    return fence;
+}
+
+bool Fence::signaled() const
+{
+    if (!sync_) { return true; }
+
+    ::GLbitfield flags(0);
+    if (!sync_->flushed
+        && (std::this_thread::get_id() == sync_->producer))
+    {
+        flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        sync_->flushed = true;
+    }
+
+    switch (::glClientWaitSync(sync_->sync, flags, 0)) {
+    case GL_ALREADY_SIGNALED:
+    case GL_CONDITION_SATISFIED:
+        return true;
+
+    case GL_TIMEOUT_EXPIRED:
+        return false;
+
+    default: break;
+    }
+
+    LOGTHROW(err2, Error) << "Failed to query GL fence sync status.";
+    return false;
+}
+
+bool Fence::wait(std::chrono::nanoseconds timeout) const
+{
+    if (!sync_) { return true; }
+
+    // flush bit flushes calling context, only producer's flush counts
+    if (std::this_thread::get_id() == sync_->producer) {
+        sync_->flushed = true;
+    }
+
+    switch (::glClientWaitSync(sync_->sync, GL_SYNC_FLUSH_COMMANDS_BIT
+                               , ::GLuint64(timeout.count())))
+    {
+    case GL_ALREADY_SIGNALED:
+    case GL_CONDITION_SATISFIED:
+        return true;
+
+    case GL_TIMEOUT_EXPIRED:
+        return false;
+
+    default: break;
+    }
+
+    LOGTHROW(err2, Error) << "Failed to wait for GL fence sync.";
+    return false;
+}
+
+void Fence::wait() const
+{
+    // wait in one second steps until signaled
+    while (!wait(std::chrono::seconds(1))) {}
+}
+
+void Fence::serverWait() const
+{
+    if (!sync_) { return; }
+    ::glWaitSync(sync_->sync, 0, GL_TIMEOUT_IGNORED);
+}
+
+} // namespace glsupport
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef sync_hpp_included_
+#define sync_hpp_included_
+
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
+#include "utility/gl.hpp"
+
+namespace glsupport {
+
+/** GL fence sync object.
+ *
+ *  Shared handle; sync object is deleted when last copy goes away.
+ */
+class Fence {
+public:
+    /** Creates empty (invalid) fence.
+     */
+    Fence() {}
+
+    /** Inserts new fence into current context's command stream.
+     *
+     *  Fence waited for in another context (of the same share group) must
+     *  reach the GPU first; flush = true flushes command stream right away.
+     *  Otherwise only waiting in the producer's thread flushes it: with
+     *  flush = false the producer must flush (or wait itself) before other
+     *  contexts can rely on the fence.
+     */
+    static Fence insert(bool flush = false);
+
+    /** Non-blocking check whether fence has been signaled. First call in
+     *  producer's thread flushes command stream to ensure fence eventually
+     *  gets signaled.
+     *
+     *  Empty fence is always signaled.
+     */
+    bool signaled() const;
+
+    /** Waits until fence is signaled or timeout expires.
+     *
+     * \return true if fence has been signaled, false on timeout
+     */
+    bool wait(std::chrono::nanoseconds timeout) const;
+
+    /** Waits until fence is signaled.
+     */
+    void wait() const;
+
+    /** Makes current context wait (on the GPU) until fence is signaled.
+     *  Returns immediately; commands issued afterwards are executed only
+     *  after fence is signaled. No-op for empty fence.
+     */
+    void serverWait() const;
+
+    ::GLsync get() const { return sync_ ? sync_->sync : nullptr; }
+
+    explicit operator bool() const { return bool(sync_); }
+
+private:
+    struct Sync {
+        ::GLsync sync;
+
+        /** Thread (and thus context) the fence was inserted in.
+         */
+        std::thread::id producer;
+        std::atomic<bool> flushed;
+
+        Sync(::GLsync sync, bool flushed)
+            : sync(sync), producer(std::this_thread::get_id())
+            , flushed(flushed)
+        {}
+        ~Sync() { ::glDeleteSync(sync); }
+    };
+
+    std::shared_ptr<Sync> sync_;
+};
+
+} // namespace glsupport
+
+#endif // sync_hpp_included_
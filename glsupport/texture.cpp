@@ -0,0 +1,217 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./texture.hpp"
+#include "./debug.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+#include "./eglimage.hpp"
+#include "./ext.hpp"
+#include "./extensions.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Preserves 2D texture binding of active texture unit.
+ */
+class BindingGuard {
+public:
+    BindingGuard(::GLuint texture) {
+        guard_.texture(GL_TEXTURE_2D);
+        state::bindTexture(GL_TEXTURE_2D, texture);
+    }
+
+private:
+    StateGuard guard_;
+};
+
+} // namespace
+
+int Texture::mipmapLevels(const math::Size2 &size)
+{
+    int levels(1);
+    for (auto s(std::max(size.width, size.height)); s > 1; s >>= 1) {
+        ++levels;
+    }
+    return levels;
+}
+
+Texture::Detail::Detail(const Params &params)
+    : params(params)
+    , levels(params.levels ? params.levels : mipmapLevels(params.size))
+    , id()
+{
+    if ((params.size.width <= 0) || (params.size.height <= 0)) {
+        LOGTHROW(err2, Error)
+            << "Invalid texture size " << params.size << ".";
+    }
+
+    ::glGenTextures(1, &id);
+    BindingGuard guard(id);
+
+    ::glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat(params.pixelType)
+                     , params.size.width, params.size.height);
+    setup();
+}
+
+Texture::Detail::Detail(const egl::Image &image, const Params &params)
+    : params(params), levels(1), id()
+{
+    typedef void (APIENTRYP ImageTargetTexStorage)
+        (::GLenum target, void *image, const ::GLint *attributes);
+    typedef void (APIENTRYP ImageTargetTexture2D)
+        (::GLenum target, void *image);
+
+    static const auto imageTargetTexStorage
+        (egl::ext::eglGetProcAddress<ImageTargetTexStorage>
+         ("glEGLImageTargetTexStorageEXT", std::nothrow));
+    static const auto imageTargetTexture2D
+        (egl::ext::eglGetProcAddress<ImageTargetTexture2D>
+         ("glEGLImageTargetTexture2DOES", std::nothrow));
+
+    if (!image) {
+        LOGTHROW(err2, Error) << "Cannot create texture from empty image.";
+    }
+
+    // the loader returns stubs for unknown GL functions
+    const bool storage(imageTargetTexStorage
+                       && hasExtension("GL_EXT_EGL_image_storage"));
+    if (!storage && !(imageTargetTexture2D
+                      && hasExtension("GL_OES_EGL_image")))
+    {
+        LOGTHROW(err2, egl::MissingExtension)
+            << "Neither GL_EXT_EGL_image_storage nor GL_OES_EGL_image "
+            "is available.";
+    }
+
+    this->params.levels = 1;
+
+    ::glGenTextures(1, &id);
+    BindingGuard guard(id);
+
+    if (storage) {
+        imageTargetTexStorage(GL_TEXTURE_2D, *image, nullptr);
+    } else {
+        imageTargetTexture2D(GL_TEXTURE_2D, *image);
+    }
+    setup();
+}
+
+void Texture::Detail::setup()
+{
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrap);
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrap);
+    ::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    try {
+        checkGl("Texture");
+    } catch (...) {
+        state::deleteTextures(1, &id);
+        throw;
+    }
+}
+
+Texture::Detail::~Detail()
+{
+    state::deleteTextures(1, &id);
+}
+
+Texture::Texture(const Params &params)
+    : detail_(std::make_shared<Detail>(params))
+{}
+
+Texture::Texture(const egl::Image &image, const Params &params)
+    : detail_(std::make_shared<Detail>(image, params))
+{}
+
+void Texture::bind(::GLuint unit) const
+{
+    state::bindTexture(unit, GL_TEXTURE_2D, get());
+}
+
+void Texture::upload(const void *data, int level) const
+{
+    upload(data, 0, 0, size(level), level);
+}
+
+void Texture::upload(const void *data, int x, int y
+                     , const math::Size2 &size, int level) const
+{
+    const auto pt(pixelType());
+
+    ::GLint alignment(0);
+    ::glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    ::glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    {
+        // data is client memory, not an offset into bound unpack buffer
+        StateGuard unpack;
+        unpack.buffer(GL_PIXEL_UNPACK_BUFFER);
+        state::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        BindingGuard guard(get());
+        ::glTexSubImage2D(GL_TEXTURE_2D, level, x, y
+                          , size.width, size.height
+                          , pixelFormat(pt), pixelComponentType(pt), data);
+    }
+
+    ::glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    checkGl("Texture::upload");
+}
+
+void Texture::generateMipmaps() const
+{
+    BindingGuard guard(get());
+    ::glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void Texture::label(const std::string &name) const
+{
+    objectLabel(GL_TEXTURE, get(), name);
+}
+
+math::Size2 Texture::size(int level) const
+{
+    const auto &s(size());
+    return math::Size2(std::max(s.width >> level, decltype(s.width)(1))
+                       , std::max(s.height >> level
+                                  , decltype(s.height)(1)));
+}
+
+std::size_t Texture::byteSize(int level) const
+{
+    const auto s(size(level));
+    return s.width * s.height * pixelSize(pixelType());
+}
+
+} // namespace glsupport
@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef texture_hpp_included_
+#define texture_hpp_included_
+
+#include <memory>
+#include <string>
+
+#include "utility/gl.hpp"
+
+#include "math/geometry_core.hpp"
+
+#include "./eglfwd.hpp"
+#include "./fb.hpp"
+
+namespace glsupport {
+
+/** 2D texture with immutable storage (glTexStorage2D).
+ *
+ *  Shared handle; texture is deleted when last copy goes away.
+ *
+ *  Texture operations preserve texture binding of the active texture unit;
+ *  only bind() changes bindings.
+ */
+class Texture {
+public:
+    struct Params {
+        math::Size2 size;
+        PixelType pixelType;
+
+        /** Number of mipmap levels, 0 = full mipmap chain.
+         */
+        int levels;
+
+        ::GLenum minFilter;
+        ::GLenum magFilter;
+        ::GLenum wrap;
+
+        /** Defaults: single level, linear filtering (nearest for integer
+         *  types), clamp to edge.
+         */
+        Params(const math::Size2 &size
+               , PixelType pixelType = PixelType::rgba8)
+            : size(size), pixelType(pixelType), levels(1)
+            , minFilter(integerPixelType(pixelType) ? GL_NEAREST : GL_LINEAR)
+            , magFilter(minFilter), wrap(GL_CLAMP_TO_EDGE)
+        {}
+    };
+
+    /** Creates empty (invalid) texture.
+     */
+    Texture() {}
+
+    Texture(const Params &params);
+
+    /** Creates texture sharing storage with given EGL image (e.g. imported
+     *  dma-buf, see dmabuf.hpp). Params must match image size and format;
+     *  image provides single level only.
+     *
+     *  Uses GL_EXT_EGL_image_storage, falls back to GL_OES_EGL_image.
+     */
+    Texture(const egl::Image &image, const Params &params);
+
+    /** Binds texture to given texture unit; leaves given unit active.
+     */
+    void bind(::GLuint unit = 0) const;
+
+    /** Synchronous upload from client memory (rows tightly packed, bottom
+     *  row first).
+     */
+    void upload(const void *data, int level = 0) const;
+
+    /** Synchronous upload of given region.
+     */
+    void upload(const void *data, int x, int y, const math::Size2 &size
+                , int level = 0) const;
+
+    /** Generates all mipmap levels from level 0.
+     */
+    void generateMipmaps() const;
+
+    /** Labels texture for GL debug output and debuggers, see
+     *  objectLabel().
+     */
+    void label(const std::string &name) const;
+
+    const Params& params() const { return detail_->params; }
+    const math::Size2& size() const { return detail_->params.size; }
+    PixelType pixelType() const { return detail_->params.pixelType; }
+
+    /** Actual number of mipmap levels.
+     */
+    int levels() const { return detail_->levels; }
+
+    /** Size of given mipmap level.
+     */
+    math::Size2 size(int level) const;
+
+    /** Size of given mipmap level content in client memory.
+     */
+    std::size_t byteSize(int level = 0) const;
+
+    ::GLuint get() const { return detail_ ? detail_->id : 0; }
+
+    explicit operator bool() const { return bool(detail_); }
+
+    /** Number of levels of full mipmap chain for given size.
+     */
+    static int mipmapLevels(const math::Size2 &size);
+
+private:
+    struct Detail {
+        Params params;
+        int levels;
+        ::GLuint id;
+
+        Detail(const Params &params);
+        Detail(const egl::Image &image, const Params &params);
+        ~Detail();
+
+        void setup();
+    };
+
+    std::shared_ptr<Detail> detail_;
+};
+
+} // namespace glsupport
+
+#endif // texture_hpp_included_
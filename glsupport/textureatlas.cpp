@@ -0,0 +1,352 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./textureatlas.hpp"
+#include "./extensions.hpp"
+#include "./debug.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+
+namespace glsupport {
+
+namespace {
+
+bool copyImageAvailable()
+{
+    ::GLint major(0), minor(0);
+    ::glGetIntegerv(GL_MAJOR_VERSION, &major);
+    ::glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return (((major << 8) | minor) >= 0x403)
+        || hasExtension("GL_ARB_copy_image");
+}
+
+/** Preserves array texture binding of active texture unit.
+ */
+class BindingGuard {
+public:
+    BindingGuard(::GLuint texture) {
+        guard_.texture(GL_TEXTURE_2D_ARRAY);
+        state::bindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    }
+
+private:
+    StateGuard guard_;
+};
+
+} // namespace
+
+/** Layer bookkeeping of one class. Shared by the class and its slots, holds
+ *  no GL object: slots can be freed in any thread.
+ */
+struct TextureAtlas::Layers {
+    mutable std::mutex mutex;
+    std::vector<int> free;
+    int next;
+    int count;
+    std::size_t used;
+
+    Layers(int count) : next(), count(count), used() {}
+
+    /** Returns free layer, -1 if class is full.
+     */
+    int acquire();
+
+    void release(int layer);
+};
+
+/** Array texture of one class. Owned by the atlas, rendering thread only.
+ */
+struct TextureAtlas::Class {
+    const TextureAtlas::Params params;
+    const int size;
+    const int maxLayers;
+
+    ::GLuint texture;
+    int layers;
+
+    std::shared_ptr<Layers> bookkeeping;
+
+    Class(const TextureAtlas::Params &params, int size, int maxLayers)
+        : params(params), size(size), maxLayers(maxLayers)
+        , texture(create(std::min(params.initialLayers, maxLayers)))
+        , layers(std::min(params.initialLayers, maxLayers))
+        , bookkeeping(std::make_shared<Layers>(layers))
+    {}
+
+    ~Class() { state::deleteTextures(1, &texture); }
+
+    ::GLuint create(int layers) const;
+
+    void grow(bool copyImage);
+
+    std::size_t memory() const {
+        return std::size_t(size) * size * layers
+            * pixelSize(params.pixelType);
+    }
+};
+
+struct TextureAtlas::Slot::Detail {
+    /** Rendering thread only; expires with the atlas.
+     */
+    std::weak_ptr<Class> cls;
+    std::shared_ptr<Layers> bookkeeping;
+    int layer;
+    math::Size2 size;
+    Rect uv;
+    PixelType pixelType;
+
+    Detail(const std::shared_ptr<Class> &cls, int layer
+           , const math::Size2 &size)
+        : cls(cls), bookkeeping(cls->bookkeeping), layer(layer), size(size)
+        , uv{ 0.f, 0.f, float(size.width) / cls->size
+              , float(size.height) / cls->size }
+        , pixelType(cls->params.pixelType)
+    {}
+
+    ~Detail() { bookkeeping->release(layer); }
+};
+
+::GLuint TextureAtlas::Class::create(int layers) const
+{
+    ::GLuint id(0);
+    ::glGenTextures(1, &id);
+    BindingGuard guard(id);
+
+    ::glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1
+                     , internalFormat(params.pixelType), size, size, layers);
+    ::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER
+                      , params.minFilter);
+    ::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER
+                      , params.magFilter);
+    ::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S
+                      , GL_CLAMP_TO_EDGE);
+    ::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T
+                      , GL_CLAMP_TO_EDGE);
+    ::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+
+    try {
+        checkGl("TextureAtlas");
+    } catch (...) {
+        state::deleteTextures(1, &id);
+        throw;
+    }
+
+    objectLabel(GL_TEXTURE, id, "atlas " + std::to_string(size) + "x"
+                + std::to_string(size) + "x" + std::to_string(layers));
+    return id;
+}
+
+int TextureAtlas::Layers::acquire()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int layer(-1);
+    if (!free.empty()) {
+        layer = free.back();
+        free.pop_back();
+    } else if (next < count) {
+        layer = next++;
+    } else {
+        return -1;
+    }
+
+    ++used;
+    return layer;
+}
+
+void TextureAtlas::Layers::release(int layer)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    free.push_back(layer);
+    --used;
+}
+
+void TextureAtlas::Class::grow(bool copyImage)
+{
+    if (!copyImage || (layers >= maxLayers)) {
+        LOGTHROW(err2, Error)
+            << "Texture atlas class " << size << "x" << size
+            << " is full (" << layers << " layers).";
+    }
+
+    const auto newLayers(std::min(layers * 2, maxLayers));
+    const auto newTexture(create(newLayers));
+
+    ::glCopyImageSubData(texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0
+                         , newTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0
+                         , size, size, layers);
+    state::deleteTextures(1, &texture);
+    checkGl("glCopyImageSubData");
+
+    LOG(info1) << "Texture atlas class " << size << "x" << size
+               << " grown from " << layers << " to " << newLayers
+               << " layers.";
+
+    texture = newTexture;
+    layers = newLayers;
+
+    std::lock_guard<std::mutex> lock(bookkeeping->mutex);
+    bookkeeping->count = newLayers;
+}
+
+TextureAtlas::TextureAtlas(const Params &params)
+    : params_(params), maxLayers_(params.maxLayers)
+    , copyImage_(copyImageAvailable())
+{
+    ::GLint maxLayers(0), maxSize(0);
+    ::glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    ::glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+
+    if (!maxLayers_ || (maxLayers_ > maxLayers)) { maxLayers_ = maxLayers; }
+    if (!params_.maxSize || (params_.maxSize > maxSize)) {
+        params_.maxSize = maxSize;
+    }
+    params_.minSize = std::max(params_.minSize, 1);
+    params_.initialLayers = std::max(params_.initialLayers, 1);
+
+    if (!copyImage_) {
+        LOG(warn2) << "glCopyImageSubData not available, texture atlas "
+            "classes cannot grow beyond " << params_.initialLayers
+                   << " layers.";
+    }
+}
+
+TextureAtlas::~TextureAtlas() {}
+
+int TextureAtlas::classSize(const math::Size2 &size) const
+{
+    const auto extent(std::max(size.width, size.height));
+    int cs(params_.minSize);
+    while (cs < extent) { cs <<= 1; }
+    return cs;
+}
+
+TextureAtlas::Slot TextureAtlas::allocate(const math::Size2 &size)
+{
+    if ((size.width <= 0) || (size.height <= 0)) {
+        LOGTHROW(err2, Error)
+            << "Invalid texture atlas image size " << size << ".";
+    }
+
+    const auto cs(classSize(size));
+    if (cs > params_.maxSize) {
+        LOGTHROW(err2, Error)
+            << "Image of size " << size << " is too big for texture atlas "
+            "(maximum class size is " << params_.maxSize << ").";
+    }
+
+    auto &cls(classes_[cs]);
+    if (!cls) { cls = std::make_shared<Class>(params_, cs, maxLayers_); }
+
+    auto layer(cls->bookkeeping->acquire());
+    if (layer < 0) {
+        cls->grow(copyImage_);
+        layer = cls->bookkeeping->acquire();
+    }
+
+    return Slot(std::make_shared<Slot::Detail>(cls, layer, size));
+}
+
+std::size_t TextureAtlas::slots() const
+{
+    std::size_t slots(0);
+    for (const auto &item : classes_) {
+        const auto &bookkeeping(*item.second->bookkeeping);
+        std::lock_guard<std::mutex> lock(bookkeeping.mutex);
+        slots += bookkeeping.used;
+    }
+    return slots;
+}
+
+std::size_t TextureAtlas::memory() const
+{
+    std::size_t memory(0);
+    for (const auto &item : classes_) { memory += item.second->memory(); }
+    return memory;
+}
+
+::GLuint TextureAtlas::Slot::texture() const
+{
+    const auto cls(detail_->cls.lock());
+    return cls ? cls->texture : 0;
+}
+
+int TextureAtlas::Slot::layer() const
+{
+    return detail_->layer;
+}
+
+const math::Size2& TextureAtlas::Slot::size() const
+{
+    return detail_->size;
+}
+
+const TextureAtlas::Rect& TextureAtlas::Slot::uv() const
+{
+    return detail_->uv;
+}
+
+PixelType TextureAtlas::Slot::pixelType() const
+{
+    return detail_->pixelType;
+}
+
+void TextureAtlas::Slot::upload(const void *data) const
+{
+    const auto tex(texture());
+    if (!tex) {
+        LOGTHROW(err2, Error)
+            << "Cannot upload to texture atlas slot: atlas is gone.";
+    }
+
+    const auto pt(pixelType());
+
+    ::GLint alignment(0);
+    ::glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    ::glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    {
+        // data is client memory, not an offset into bound unpack buffer
+        StateGuard unpack;
+        unpack.buffer(GL_PIXEL_UNPACK_BUFFER);
+        state::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        BindingGuard guard(tex);
+        ::glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer()
+                          , size().width, size().height, 1
+                          , pixelFormat(pt), pixelComponentType(pt), data);
+    }
+
+    ::glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    checkGl("TextureAtlas::Slot::upload");
+}
+
+} // namespace glsupport
@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef textureatlas_hpp_included_
+#define textureatlas_hpp_included_
+
+#include <map>
+#include <memory>
+
+#include "utility/gl.hpp"
+
+#include "math/geometry_core.hpp"
+
+#include "./fb.hpp"
+
+namespace glsupport {
+
+/** Atlas of many small textures backed by texture arrays.
+ *
+ *  Images are sorted into size classes (powers of two); each class is one
+ *  GL_TEXTURE_2D_ARRAY whose layers are as big as the class and every image
+ *  occupies one layer. Allocated slot is identified by layer and UV
+ *  rectangle of the image inside the layer (smaller images occupy only part
+ *  of the layer). Thus all images of one class are accessible through a
+ *  single texture binding and can be drawn by single (instanced) draw call.
+ *
+ *  Freed layers are recycled. When a class runs out of layers its array is
+ *  reallocated with twice as many layers and the content is copied over by
+ *  glCopyImageSubData (GL 4.3 or GL_ARB_copy_image; without it classes
+ *  cannot grow beyond initial number of layers). Texture name of the class
+ *  changes in that case: use Slot::texture() when binding.
+ *
+ *  Atlas must be used in thread with its context current. Textures are
+ *  owned by the atlas and deleted with it; slots hold only layer
+ *  bookkeeping: they can be freed (i.e. destroyed) in any thread and can
+ *  outlive the atlas (Slot::texture() returns 0 then).
+ */
+class TextureAtlas {
+public:
+    class Slot;
+
+    struct Params {
+        PixelType pixelType;
+
+        /** Smallest class size.
+         */
+        int minSize;
+
+        /** Largest class size, 0 = GL_MAX_TEXTURE_SIZE.
+         */
+        int maxSize;
+
+        /** Number of layers of new class.
+         */
+        int initialLayers;
+
+        /** Maximum layers per class, 0 = GL_MAX_ARRAY_TEXTURE_LAYERS.
+         */
+        int maxLayers;
+
+        ::GLenum minFilter;
+        ::GLenum magFilter;
+
+        Params(PixelType pixelType = PixelType::rgba8)
+            : pixelType(pixelType), minSize(16), maxSize(), initialLayers(8)
+            , maxLayers()
+            , minFilter(integerPixelType(pixelType) ? GL_NEAREST : GL_LINEAR)
+            , magFilter(minFilter)
+        {}
+    };
+
+    /** Texture coordinates rectangle.
+     */
+    struct Rect {
+        float u0, v0, u1, v1;
+    };
+
+    TextureAtlas(const Params &params = Params());
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    /** Allocates slot for image of given size. Throws when image is bigger
+     *  than largest class or the class is full.
+     */
+    Slot allocate(const math::Size2 &size);
+
+    /** Size of class given image belongs to.
+     */
+    int classSize(const math::Size2 &size) const;
+
+    /** Number of allocated slots.
+     */
+    std::size_t slots() const;
+
+    /** Memory occupied by all classes' textures.
+     */
+    std::size_t memory() const;
+
+    const Params& params() const { return params_; }
+
+private:
+    struct Layers;
+    struct Class;
+
+    Params params_;
+    int maxLayers_;
+    bool copyImage_;
+
+    std::map<int, std::shared_ptr<Class> > classes_;
+};
+
+/** Allocated slot. Shared handle; slot is freed when last copy goes away.
+ */
+class TextureAtlas::Slot {
+public:
+    Slot() {}
+
+    /** Current array texture of slot's class, 0 if the atlas is gone.
+     *  Rendering thread only.
+     */
+    ::GLuint texture() const;
+
+    int layer() const;
+
+    /** Size of the image.
+     */
+    const math::Size2& size() const;
+
+    /** Image's rectangle inside the layer; origin at layer's origin.
+     */
+    const Rect& uv() const;
+
+    PixelType pixelType() const;
+
+    /** Synchronous upload from client memory (rows tightly packed, bottom
+     *  row first). Rendering thread only, throws if the atlas is gone.
+     */
+    void upload(const void *data) const;
+
+    explicit operator bool() const { return bool(detail_); }
+
+private:
+    friend class TextureAtlas;
+    struct Detail;
+
+    Slot(const std::shared_ptr<Detail> &detail) : detail_(detail) {}
+
+    std::shared_ptr<Detail> detail_;
+};
+
+} // namespace glsupport
+
+#endif // textureatlas_hpp_included_
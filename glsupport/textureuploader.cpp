@@ -0,0 +1,564 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./textureuploader.hpp"
+#include "./streambuffer.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Staging allocation alignment; covers any pixel component type.
+ */
+constexpr std::size_t stagingAlignment(16);
+
+/** Row alignment in staging memory (GL_UNPACK_ALIGNMENT).
+ */
+constexpr std::size_t rowAlignment(4);
+
+inline std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+} // namespace
+
+struct TextureUploader::Upload::State {
+    std::atomic<Status> status;
+
+    mutable std::mutex mutex;
+    Fence fence;
+    std::string error;
+
+    State() : status(Status::queued) {}
+};
+
+struct TextureUploader::Detail {
+    typedef Upload::Status Status;
+
+    /** Staging memory range, released out of order.
+     */
+    struct Span {
+        std::uint64_t end;
+        bool released;
+    };
+
+    struct Job {
+        std::shared_ptr<Upload::State> state;
+
+        /** Destination: texture or atlas slot.
+         */
+        Texture texture;
+        TextureAtlas::Slot slot;
+        int level;
+        int x;
+        int y;
+        math::Size2 size;
+        Fill fill;
+
+        std::size_t stride;
+        std::size_t bytes;
+
+        /** Staging memory.
+         */
+        std::size_t offset;
+        Span *span;
+    };
+
+    typedef std::shared_ptr<Job> JobPtr;
+
+    /** Uploads issued together, completed by single fence.
+     */
+    struct Batch {
+        Fence fence;
+        std::vector<JobPtr> jobs;
+    };
+
+    const std::size_t capacity;
+    const bool persistent;
+    ::GLuint pbo;
+    char *base;
+    std::unique_ptr<char[]> memory;
+
+    /** Staging ring: total bytes allocated and released; position is
+     *  written % capacity.
+     */
+    std::uint64_t written;
+    std::uint64_t released;
+    std::deque<Span> spans;
+
+    /** Render thread only. Jobs handed to workers are kept in submission
+     *  order and issued in that order once filled.
+     */
+    std::deque<JobPtr> queued;
+    std::deque<JobPtr> handed;
+    std::deque<Batch> issued;
+    std::size_t pending;
+
+    /** Shared with workers.
+     */
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<JobPtr> work;
+    bool stop;
+    std::vector<std::thread> workers;
+
+    Detail(std::size_t capacity, std::size_t threads);
+    ~Detail();
+
+    void run();
+
+    /** Allocates staging memory for job; false when there is not enough
+     *  free memory right now.
+     */
+    bool allocate(Job &job);
+
+    void release(Job &job);
+
+    /** Finishes job setup and queues it.
+     */
+    Upload queue(const JobPtr &job, PixelType pixelType);
+
+    void finished(Job &job, Status status);
+
+    /** Completes uploads with signaled fences.
+     */
+    std::size_t complete();
+
+    /** Issues filled uploads in submission order; stops at first upload
+     *  still being filled.
+     */
+    std::size_t issue(std::size_t budget);
+};
+
+TextureUploader::Detail::Detail(std::size_t capacity, std::size_t threads)
+    : capacity(capacity)
+    , persistent(StreamBuffer::persistentAvailable())
+    , pbo(), base(), written(), released(), pending(), stop(false)
+{
+    if (!capacity) {
+        LOGTHROW(err2, Error) << "Texture uploader needs staging memory.";
+    }
+
+    if (persistent) {
+        const ::GLbitfield flags(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                                 | GL_MAP_COHERENT_BIT);
+        ::glGenBuffers(1, &pbo);
+        state::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        ::glBufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, flags);
+        base = static_cast<char*>
+            (::glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity, flags));
+        state::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (!base) {
+            state::deleteBuffers(1, &pbo);
+            LOGTHROW(err2, Error)
+                << "Cannot map texture upload staging buffer.";
+        }
+    } else {
+        memory.reset(new char[capacity]);
+        base = memory.get();
+    }
+
+    checkGl("TextureUploader");
+
+    for (std::size_t i(0); i < std::max(threads, std::size_t(1)); ++i) {
+        workers.emplace_back(&Detail::run, this);
+    }
+
+    LOG(info1) << "Created texture uploader with " << capacity
+               << " bytes of " << (persistent ? "mapped" : "client")
+               << " staging memory and " << workers.size()
+               << " worker(s).";
+}
+
+TextureUploader::Detail::~Detail()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_all();
+    for (auto &worker : workers) { worker.join(); }
+
+    // deleting buffer unmaps it; GL keeps it alive for issued uploads
+    if (pbo) { state::deleteBuffers(1, &pbo); }
+}
+
+void TextureUploader::Detail::run()
+{
+    for (;;) {
+        JobPtr job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]() { return stop || !work.empty(); });
+            if (stop) { return; }
+            job = work.front();
+            work.pop_front();
+        }
+
+        auto status(Status::staged);
+        try {
+            job->fill(base + job->offset, job->stride);
+        } catch (const std::exception &e) {
+            std::lock_guard<std::mutex> lock(job->state->mutex);
+            job->state->error = e.what();
+            status = Status::failed;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job->state->mutex);
+            job->state->error = "unknown exception";
+            status = Status::failed;
+        }
+
+        if (status == Status::failed) {
+            LOG(err2) << "Texture upload failed: " << job->state->error;
+        }
+
+        // publishes filled staging memory to the render thread
+        job->state->status = status;
+    }
+}
+
+bool TextureUploader::Detail::allocate(Job &job)
+{
+    if (written == released) {
+        // ring is empty, start from the beginning
+        written = released = alignUp(written, capacity);
+    }
+
+    const auto position(written % capacity);
+    auto offset(alignUp(position, stagingAlignment));
+    if (offset + job.bytes > capacity) {
+        // wrap around, skip ring's tail
+        offset = 0;
+    }
+
+    const auto end(written + (offset - position) + job.bytes
+                   + ((offset < position) ? capacity : 0));
+    if ((end - released) > capacity) { return false; }
+
+    written = end;
+    spans.push_back({ end, false });
+    job.offset = offset;
+    job.span = &spans.back();
+    return true;
+}
+
+TextureUploader::Upload
+TextureUploader::Detail::queue(const JobPtr &job, PixelType pixelType)
+{
+    job->state = std::make_shared<Upload::State>();
+    job->stride = alignUp(job->size.width * pixelSize(pixelType)
+                          , rowAlignment);
+    job->bytes = job->stride * job->size.height;
+    job->offset = 0;
+    job->span = nullptr;
+
+    if (job->bytes > capacity) {
+        LOGTHROW(err2, Error)
+            << "Texture upload of " << job->bytes
+            << " bytes exceeds staging memory of " << capacity
+            << " bytes.";
+    }
+
+    queued.push_back(job);
+    ++pending;
+    return Upload(job->state);
+}
+
+void TextureUploader::Detail::release(Job &job)
+{
+    job.span->released = true;
+    while (!spans.empty() && spans.front().released) {
+        released = spans.front().end;
+        spans.pop_front();
+    }
+}
+
+void TextureUploader::Detail::finished(Job &job, Status status)
+{
+    job.state->status = status;
+    release(job);
+    job.fill = {};
+    job.texture = {};
+    job.slot = {};
+    --pending;
+}
+
+std::size_t TextureUploader::Detail::complete()
+{
+    std::size_t completed(0);
+    while (!issued.empty() && issued.front().fence.signaled()) {
+        for (const auto &job : issued.front().jobs) {
+            finished(*job, Status::done);
+            ++completed;
+        }
+        issued.pop_front();
+    }
+    return completed;
+}
+
+std::size_t TextureUploader::Detail::issue(std::size_t budget)
+{
+    std::size_t completed(0);
+    while (!handed.empty() && (handed.front()->state->status
+                               == Status::failed))
+    {
+        finished(*handed.front(), Status::failed);
+        handed.pop_front();
+        ++completed;
+    }
+
+    if (handed.empty()
+        || (handed.front()->state->status == Status::filling))
+    {
+        return completed;
+    }
+
+    StateGuard guard;
+    guard.texture(GL_TEXTURE_2D).texture(GL_TEXTURE_2D_ARRAY)
+        .buffer(GL_PIXEL_UNPACK_BUFFER);
+
+    ::GLint alignment(0);
+    ::glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    ::glPixelStorei(GL_UNPACK_ALIGNMENT, rowAlignment);
+
+    // client memory is read only when no unpack buffer is bound
+    state::bindBuffer(GL_PIXEL_UNPACK_BUFFER, persistent ? pbo : 0);
+
+    Batch batch;
+    std::size_t bytes(0);
+    while (!handed.empty()) {
+        const auto job(handed.front());
+        if (job->state->status == Status::filling) { break; }
+
+        if (job->slot && !job->slot.texture()) {
+            std::lock_guard<std::mutex> lock(job->state->mutex);
+            job->state->error = "texture atlas is gone";
+            LOG(err2) << "Texture upload failed: " << job->state->error;
+            job->state->status = Status::failed;
+        }
+
+        if (job->state->status == Status::failed) {
+            finished(*job, Status::failed);
+            handed.pop_front();
+            ++completed;
+            continue;
+        }
+
+        if (budget && bytes && ((bytes + job->bytes) > budget)) { break; }
+        handed.pop_front();
+
+        // offset into bound unpack buffer or pointer to client memory
+        const void *pixels(persistent
+                           ? reinterpret_cast<const void*>(job->offset)
+                           : base + job->offset);
+
+        if (job->slot) {
+            const auto pt(job->slot.pixelType());
+            state::bindTexture(GL_TEXTURE_2D_ARRAY, job->slot.texture());
+            ::glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0
+                              , job->slot.layer(), job->size.width
+                              , job->size.height, 1, pixelFormat(pt)
+                              , pixelComponentType(pt), pixels);
+        } else {
+            const auto pt(job->texture.pixelType());
+            state::bindTexture(GL_TEXTURE_2D, job->texture.get());
+            ::glTexSubImage2D(GL_TEXTURE_2D, job->level, job->x, job->y
+                              , job->size.width, job->size.height
+                              , pixelFormat(pt), pixelComponentType(pt)
+                              , pixels);
+        }
+        job->state->status = Status::issued;
+
+        bytes += job->bytes;
+        batch.jobs.push_back(job);
+    }
+
+    ::glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+    if (!batch.jobs.empty()) {
+        batch.fence = Fence::insert();
+        for (const auto &job : batch.jobs) {
+            std::lock_guard<std::mutex> lock(job->state->mutex);
+            job->state->fence = batch.fence;
+        }
+        issued.push_back(std::move(batch));
+    }
+
+    return completed;
+}
+
+TextureUploader::TextureUploader(std::size_t staging, std::size_t threads)
+    : detail_(new Detail(staging, threads))
+{}
+
+TextureUploader::~TextureUploader() {}
+
+TextureUploader::Upload
+TextureUploader::upload(const Texture &texture, int x, int y
+                        , const math::Size2 &size, const Fill &fill
+                        , int level)
+{
+    auto job(std::make_shared<Detail::Job>());
+    job->texture = texture;
+    job->level = level;
+    job->x = x;
+    job->y = y;
+    job->size = size;
+    job->fill = fill;
+    return detail_->queue(job, texture.pixelType());
+}
+
+TextureUploader::Upload
+TextureUploader::upload(const TextureAtlas::Slot &slot, const Fill &fill)
+{
+    auto job(std::make_shared<Detail::Job>());
+    job->slot = slot;
+    job->level = job->x = job->y = 0;
+    job->size = slot.size();
+    job->fill = fill;
+    return detail_->queue(job, slot.pixelType());
+}
+
+TextureUploader::Upload
+TextureUploader::upload(const Texture &texture, const Fill &fill, int level)
+{
+    return upload(texture, 0, 0, texture.size(level), fill, level);
+}
+
+TextureUploader::Upload
+TextureUploader::upload(const Texture &texture
+                        , std::vector<unsigned char> data, int level)
+{
+    if (data.size() != texture.byteSize(level)) {
+        LOGTHROW(err2, Error)
+            << "Texture upload data size " << data.size()
+            << " does not match level " << level << " size "
+            << texture.byteSize(level) << ".";
+    }
+
+    const auto size(texture.size(level));
+    const std::size_t row(size.width * pixelSize(texture.pixelType()));
+    const auto src(std::make_shared<std::vector<unsigned char> >
+                   (std::move(data)));
+
+    return upload(texture, 0, 0, size
+                  , [src, row](void *data, std::size_t stride)
+    {
+        auto *dst(static_cast<unsigned char*>(data));
+        for (auto s(src->data()), e(s + src->size()); s != e; s += row) {
+            std::memcpy(dst, s, row);
+            dst += stride;
+        }
+    }, level);
+}
+
+std::size_t TextureUploader::process(std::size_t budget)
+{
+    auto &d(*detail_);
+
+    auto completed(d.complete());
+    completed += d.issue(budget);
+
+    // hand queued uploads over to workers, in order
+    std::size_t handed(0);
+    while (!d.queued.empty() && d.allocate(*d.queued.front())) {
+        const auto job(d.queued.front());
+        d.queued.pop_front();
+        job->state->status = Upload::Status::filling;
+        d.handed.push_back(job);
+
+        std::lock_guard<std::mutex> lock(d.mutex);
+        d.work.push_back(job);
+        ++handed;
+    }
+
+    if (handed == 1) {
+        d.cond.notify_one();
+    } else if (handed) {
+        d.cond.notify_all();
+    }
+
+    checkGl("TextureUploader::process");
+    return completed;
+}
+
+void TextureUploader::finish()
+{
+    auto &d(*detail_);
+    while (d.pending) {
+        if (process()) { continue; }
+
+        if (!d.issued.empty()) {
+            d.issued.front().fence.wait();
+        } else {
+            // workers are still filling
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+std::size_t TextureUploader::pending() const
+{
+    return detail_->pending;
+}
+
+bool TextureUploader::persistent() const
+{
+    return detail_->persistent;
+}
+
+TextureUploader::Upload::Status TextureUploader::Upload::status() const
+{
+    return state_->status;
+}
+
+Fence TextureUploader::Upload::fence() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->fence;
+}
+
+std::string TextureUploader::Upload::error() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->error;
+}
+
+} // namespace glsupport
@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef textureuploader_hpp_included_
+#define textureuploader_hpp_included_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./texture.hpp"
+#include "./textureatlas.hpp"
+#include "./sync.hpp"
+
+namespace glsupport {
+
+/** Asynchronous texture upload queue.
+ *
+ *  Pixel data are produced (decoded, copied...) by worker threads directly
+ *  into staging memory: a persistently mapped pixel unpack buffer (GL 4.4 or
+ *  GL_ARB_buffer_storage). Render thread then only issues glTexSubImage2D
+ *  from the buffer, which is a GPU-side copy, and a fence marking
+ *  completion. Staging memory is a ring; it is reused once its uploads'
+ *  fence is signaled.
+ *
+ *  Without persistent mapping staging memory is plain client memory and
+ *  glTexSubImage2D copies from it (still off the worker threads' way, but
+ *  synchronously).
+ *
+ *  Usage:
+ *      TextureUploader uploader(32 << 20);
+ *      auto upload(uploader.upload(texture, [&](void *data
+ *                                               , std::size_t stride)
+ *      {
+ *          decodeTile(tile, data, stride);
+ *      }));
+ *      for (;;) {
+ *          uploader.process(); // once per frame
+ *          if (upload.done()) { use(texture); }
+ *          ...
+ *      }
+ *
+ *  Uploader and its uploads belong to the context (share group) they were
+ *  created in; all operations except the fill functions must be performed
+ *  in thread with that context current.
+ */
+class TextureUploader {
+public:
+    class Upload;
+
+    /** Fills staging memory: writes region's rows (bottom row first), each
+     *  row stride bytes apart. Called in worker thread; may throw.
+     */
+    typedef std::function<void(void *data, std::size_t stride)> Fill;
+
+    /**
+     * \param staging size of staging memory in bytes; limits the largest
+     *                single upload and amount of data in flight
+     * \param threads number of worker threads
+     */
+    TextureUploader(std::size_t staging, std::size_t threads = 2);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    /** Queues upload of given region of given texture level.
+     */
+    Upload upload(const Texture &texture, int x, int y
+                  , const math::Size2 &size, const Fill &fill
+                  , int level = 0);
+
+    /** Queues upload of whole texture level.
+     */
+    Upload upload(const Texture &texture, const Fill &fill, int level = 0);
+
+    /** Queues upload of whole texture level from given data (rows tightly
+     *  packed, bottom row first).
+     */
+    Upload upload(const Texture &texture, std::vector<unsigned char> data
+                  , int level = 0);
+
+    /** Queues upload of texture atlas slot's image. Upload goes to the
+     *  slot's class texture current at the time of issue.
+     */
+    Upload upload(const TextureAtlas::Slot &slot, const Fill &fill);
+
+    /** Advances the queue; call regularly (e.g. once per frame) in render
+     *  thread. Completes finished uploads, issues staged ones and hands
+     *  queued ones to workers when there is staging memory available.
+     *
+     * \param budget maximum number of bytes to issue, 0 = unlimited
+     * \return number of completed uploads
+     */
+    std::size_t process(std::size_t budget = 0);
+
+    /** Processes queue until all uploads are done. Blocking.
+     */
+    void finish();
+
+    /** Number of uploads not done yet.
+     */
+    std::size_t pending() const;
+
+    /** Staging memory is persistently mapped pixel buffer.
+     */
+    bool persistent() const;
+
+private:
+    struct Detail;
+    std::unique_ptr<Detail> detail_;
+};
+
+/** Handle to queued upload.
+ */
+class TextureUploader::Upload {
+public:
+    enum class Status {
+        /** Waiting for staging memory.
+         */
+        queued
+        /** Being filled by worker.
+         */
+        , filling
+        /** Filled, waiting to be issued.
+         */
+        , staged
+        /** Issued, waiting for GPU.
+         */
+        , issued
+        , done
+        , failed
+    };
+
+    Upload() {}
+
+    Status status() const;
+
+    bool done() const { return status() == Status::done; }
+    bool failed() const { return status() == Status::failed; }
+
+    /** Fence signaled once the upload is finished on GPU; empty until
+     *  issued. Other contexts can wait for it (glWaitSync).
+     */
+    Fence fence() const;
+
+    /** Failure reason.
+     */
+    std::string error() const;
+
+    explicit operator bool() const { return bool(state_); }
+
+private:
+    friend class TextureUploader;
+    struct State;
+
+    Upload(const std::shared_ptr<State> &state) : state_(state) {}
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace glsupport
+
+#endif // textureuploader_hpp_included_
@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./tiledrenderer.hpp"
+#include "./glerror.hpp"
+#include "./statecache.hpp"
+
+namespace glsupport {
+
+namespace {
+
+const FrameBuffer::Params& checkTile(const FrameBuffer::Params &tile
+                                     , const math::Size2 &size)
+{
+    if ((size.width <= 0) || (size.height <= 0)) {
+        LOGTHROW(err2, Error) << "Invalid tiled image size " << size << ".";
+    }
+
+    const auto &ts(tile.size);
+    const auto limit(TiledRenderer::maxTileSize());
+    if ((ts.width <= 0) || (ts.height <= 0)
+        || (ts.width > limit.width) || (ts.height > limit.height))
+    {
+        LOGTHROW(err2, Error)
+            << "Invalid tile size " << ts << " (limit is " << limit << ").";
+    }
+    return tile;
+}
+
+/** Maps pixel coordinate in [0, total] to NDC [-1, 1].
+ */
+inline double ndc(long pixel, long total)
+{
+    return (2.0 * pixel) / total - 1.0;
+}
+
+} // namespace
+
+TiledRenderer::TiledRenderer(const FrameBuffer::Params &tile
+                             , const math::Size2 &size
+                             , std::size_t attachment)
+    : size_(size), attachment_(attachment)
+    , fb_(checkTile(tile, size))
+    , readback_(fb_, 2, attachment)
+{}
+
+math::Size2 TiledRenderer::maxTileSize()
+{
+    ::GLint texture(0), renderbuffer(0), viewport[2] = { 0, 0 };
+    ::glGetIntegerv(GL_MAX_TEXTURE_SIZE, &texture);
+    ::glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &renderbuffer);
+    ::glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewport);
+    checkGl("max tile size");
+
+    const auto common(std::min(texture, renderbuffer));
+    return math::Size2(std::min(common, viewport[0])
+                       , std::min(common, viewport[1]));
+}
+
+math::Size2 TiledRenderer::grid() const
+{
+    const auto &ts(fb_.size());
+    return math::Size2((size_.width + ts.width - 1) / ts.width
+                       , (size_.height + ts.height - 1) / ts.height);
+}
+
+TiledRenderer::Tile TiledRenderer::tile(long column, long row) const
+{
+    const auto &ts(fb_.size());
+
+    Tile t;
+    t.column = column;
+    t.row = row;
+    t.x = column * ts.width;
+    t.y = row * ts.height;
+    t.size = math::Size2(std::min(ts.width, size_.width - t.x)
+                         , std::min(ts.height, size_.height - t.y));
+
+    // full tile window, may extend past right/bottom image edge; image row
+    // 0 is at the top (NDC y = 1)
+    t.left = ndc(t.x, size_.width);
+    t.right = ndc(t.x + ts.width, size_.width);
+    t.top = -ndc(t.y, size_.height);
+    t.bottom = -ndc(t.y + ts.height, size_.height);
+
+    // scale window to [-1, 1] and move its center to the origin:
+    // ndc' = s * (ndc - c), in clip space: x' = s * x - s * c * w
+    const double sx(2.0 / (t.right - t.left));
+    const double sy(2.0 / (t.top - t.bottom));
+    const double cx((t.left + t.right) / 2.0);
+    const double cy((t.bottom + t.top) / 2.0);
+
+    t.clip.fill(0.f);
+    t.clip[0] = float(sx);
+    t.clip[5] = float(sy);
+    t.clip[10] = 1.f;
+    t.clip[12] = float(-sx * cx);
+    t.clip[13] = float(-sy * cy);
+    t.clip[15] = 1.f;
+
+    return t;
+}
+
+void TiledRenderer::render(const Render &render, const Sink &sink)
+{
+    const auto &ts(fb_.size());
+    const auto grid(this->grid());
+    const auto pixel(pixelSize(fb_.pixelType(attachment_)));
+    const std::size_t stride(size_.width * pixel);
+
+    // one row of tiles, top-down
+    std::vector<unsigned char> band(stride * ts.height);
+
+    StateGuard guard;
+    guard.framebuffers().viewport();
+
+    // copies tile into the band, flushes the band after its last tile
+    const auto consume([&](Readback::Frame &frame, const Tile &t)
+    {
+        {
+            const auto m(frame.map());
+            const auto *data(static_cast<const unsigned char*>(m.data()));
+            const std::size_t width(t.size.width * pixel);
+            for (long r(0); r < t.size.height; ++r) {
+                // GL rows are bottom-up
+                const auto *src(data + (ts.height - 1 - r) * m.stride());
+                std::memcpy(&band[r * stride + t.x * pixel], src, width);
+            }
+        }
+        frame = {};
+
+        if (t.column == grid.width - 1) {
+            sink(band.data(), t.y, t.size.height, stride);
+        }
+    });
+
+    Readback::Frame pending;
+    Tile pendingTile = Tile();
+
+    for (long row(0); row < grid.height; ++row) {
+        for (long column(0); column < grid.width; ++column) {
+            const auto t(tile(column, row));
+
+            fb_.bind();
+            state::viewport(0, 0, ts.width, ts.height);
+            render(t);
+
+            auto frame(readback_.read());
+
+            // previous tile is (hopefully) ready by now
+            if (pending) { consume(pending, pendingTile); }
+            pending = frame;
+            pendingTile = t;
+        }
+    }
+
+    if (pending) { consume(pending, pendingTile); }
+
+    checkGl("tiled render");
+}
+
+} // namespace glsupport
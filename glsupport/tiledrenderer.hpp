@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef tiledrenderer_hpp_included_
+#define tiledrenderer_hpp_included_
+
+#include <array>
+#include <functional>
+
+#include "math/geometry_core.hpp"
+
+#include "./fb.hpp"
+#include "./readback.hpp"
+
+namespace glsupport {
+
+/** Renders images larger than GL limits (maximum texture/viewport size) tile
+ *  by tile.
+ *
+ *  Output image is split into a grid of equally sized tiles rendered into a
+ *  single tile-sized framebuffer. Tiles are rendered in scanline order (rows
+ *  of tiles top-down, tiles left to right); readback of each tile overlaps
+ *  rendering of the next one. Pixels are collected in a single band (one row
+ *  of tiles) and handed over to the sink when the band is complete.
+ *
+ *  Memory use is constant with respect to image height: one tile-sized
+ *  framebuffer, two readback buffers and one band of
+ *  width x tile height pixels. Use short wide tiles to keep the band small.
+ *
+ *  Edge tiles are rendered in full size with projection extending past the
+ *  image edge; only pixels inside the image reach the sink.
+ *
+ *  All operations must be performed with GL context current.
+ */
+class TiledRenderer {
+public:
+    struct Tile;
+
+    /** Renders single tile. Called with tile framebuffer bound and viewport
+     *  set to the whole tile.
+     */
+    typedef std::function<void(const Tile &tile)> Render;
+
+    /** Receives finished image rows: `rows` rows starting at image row
+     *  `firstRow`, top-down, each `stride` bytes long (tightly packed,
+     *  image width x pixel size). Data are valid only during the call.
+     */
+    typedef std::function<void(const void *data, std::size_t firstRow
+                               , std::size_t rows, std::size_t stride)>
+        Sink;
+
+    /** Creates renderer of image of given size.
+     *
+     * \param tile tile framebuffer parameters; size is the tile size
+     * \param size output image size
+     * \param attachment color attachment to read
+     */
+    TiledRenderer(const FrameBuffer::Params &tile, const math::Size2 &size
+                  , std::size_t attachment = 0);
+
+    TiledRenderer(const TiledRenderer&) = delete;
+    TiledRenderer& operator=(const TiledRenderer&) = delete;
+
+    /** Renders whole image, streaming rows to the sink.
+     *  Restores framebuffer binding and viewport when done.
+     */
+    void render(const Render &render, const Sink &sink);
+
+    /** Output image size.
+     */
+    const math::Size2& size() const { return size_; }
+
+    /** Tile size.
+     */
+    const math::Size2& tileSize() const { return fb_.size(); }
+
+    /** Number of tile columns and rows.
+     */
+    math::Size2 grid() const;
+
+    /** Tile framebuffer.
+     */
+    const FrameBuffer& frameBuffer() const { return fb_; }
+
+    /** Largest tile size supported by current context (limited by
+     *  maximum texture, renderbuffer and viewport size).
+     */
+    static math::Size2 maxTileSize();
+
+private:
+    Tile tile(long column, long row) const;
+
+    const math::Size2 size_;
+    const std::size_t attachment_;
+    FrameBuffer fb_;
+    Readback readback_;
+};
+
+/** Rendered tile.
+ */
+struct TiledRenderer::Tile {
+    /** Tile column and row in the grid.
+     */
+    long column;
+    long row;
+
+    /** Position of tile's top-left pixel in the image.
+     */
+    long x;
+    long y;
+
+    /** Part of the tile inside the image (smaller than tile size for edge
+     *  tiles).
+     */
+    math::Size2 size;
+
+    /** Tile window in normalized device coordinates of the whole image.
+     */
+    double left;
+    double right;
+    double bottom;
+    double top;
+
+    /** Maps clip coordinates of the whole image to clip coordinates of this
+     *  tile; column-major 4x4 matrix. Premultiply image projection by it:
+     *  tileProjection = clip * projection.
+     */
+    std::array<float, 16> clip;
+};
+
+} // namespace glsupport
+
+#endif // tiledrenderer_hpp_included_
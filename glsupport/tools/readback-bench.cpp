@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** Compares synchronous glReadPixels with Readback PBO ring.
+ *
+ *  Usage: glsupport-readback-bench [WIDTHxHEIGHT [FRAMES [DEPTH...]]]
+ *
+ *  Runs headless (surfaceless EGL platform), e.g. under Mesa llvmpipe:
+ *      EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 \
+ *          glsupport-readback-bench 1920x1080 200 2 3 4
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../egl.hpp"
+#include "../fb.hpp"
+#include "../shader.hpp"
+#include "../readback.hpp"
+
+namespace gls = glsupport;
+
+namespace {
+
+const char *vertexShader(R"RAW(#version 330
+void main() {
+    // full-screen triangle
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)RAW");
+
+const char *fragmentShader(R"RAW(#version 330
+uniform int frame;
+out vec4 color;
+void main() {
+    // a bit of per-pixel work so that rendering is not free
+    vec2 p = gl_FragCoord.xy * 0.01 + float(frame);
+    float v = 0.0;
+    for (int i = 0; i < 16; ++i) { v += sin(p.x * float(i)) * cos(p.y); }
+    color = vec4(fract(v), fract(v * 0.5), float(frame & 255) / 255.0, 1.0);
+}
+)RAW");
+
+typedef std::chrono::steady_clock Clock;
+
+struct Renderer {
+    gls::Program program;
+    ::GLuint vao;
+    ::GLint frame;
+
+    Renderer() : vao(), frame() {
+        program.link(vertexShader, fragmentShader);
+        frame = program.uniform("frame");
+        ::glGenVertexArrays(1, &vao);
+    }
+
+    ~Renderer() { ::glDeleteVertexArrays(1, &vao); }
+
+    void operator()(int i) const {
+        program.use();
+        ::glBindVertexArray(vao);
+        ::glUniform1i(frame, i);
+        ::glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+};
+
+/** Touches the data like a real consumer would (and prevents the read
+ *  from being optimized out).
+ */
+std::size_t consume(const void *data, std::size_t size)
+{
+    const auto *p(static_cast<const unsigned char*>(data));
+    std::size_t sum(0);
+    for (std::size_t i(0); i < size; i += 64) { sum += p[i]; }
+    return sum;
+}
+
+void report(const std::string &name, int frames, Clock::duration duration)
+{
+    const auto ms(std::chrono::duration<double, std::milli>
+                  (duration).count());
+    std::printf("%-12s %9.2f ms total %8.3f ms/frame %8.1f fps\n"
+                , name.c_str(), ms, ms / frames, 1000.0 * frames / ms);
+}
+
+std::size_t synchronous(const gls::FrameBuffer &fb, const Renderer &render
+                        , int frames)
+{
+    const auto &size(fb.size());
+    std::vector<unsigned char> buffer(fb.byteSize());
+    ::glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    std::size_t sum(0);
+    const auto start(Clock::now());
+    for (int i(0); i < frames; ++i) {
+        render(i);
+        ::glReadPixels(0, 0, size.width, size.height, GL_RGBA
+                       , GL_UNSIGNED_BYTE, buffer.data());
+        sum += consume(buffer.data(), buffer.size());
+    }
+    report("sync", frames, Clock::now() - start);
+    return sum;
+}
+
+std::size_t ring(const gls::FrameBuffer &fb, const Renderer &render
+                 , int frames, std::size_t depth)
+{
+    gls::Readback readback(fb, depth);
+    std::deque<gls::Readback::Frame> pending;
+
+    std::size_t sum(0);
+    const auto pop([&]() {
+        const auto mapping(pending.front().map());
+        sum += consume(mapping.data(), mapping.size());
+        pending.pop_front();
+    });
+
+    const auto start(Clock::now());
+    for (int i(0); i < frames; ++i) {
+        render(i);
+        // frame K is consumed while frames K+1...K+depth-1 are in flight
+        if (pending.size() == depth) { pop(); }
+        pending.push_back(readback.read());
+    }
+    while (!pending.empty()) { pop(); }
+
+    report("ring/" + std::to_string(depth), frames, Clock::now() - start);
+    return sum;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    dbglog::set_mask("W2E2");
+
+    long width(1920), height(1080);
+    int frames(200);
+    std::vector<std::size_t> depths;
+
+    if ((argc > 1)
+        && (std::sscanf(argv[1], "%ldx%ld", &width, &height) != 2))
+    {
+        std::cerr << "Invalid size <" << argv[1] << ">.\n";
+        return EXIT_FAILURE;
+    }
+    if (argc > 2) { frames = std::atoi(argv[2]); }
+    for (int i(3); i < argc; ++i) { depths.push_back(std::atoi(argv[i])); }
+    if (depths.empty()) { depths = { 2, 3, 4 }; }
+
+    try {
+        gls::egl::Display dpy{gls::egl::Surfaceless()};
+        ::eglBindAPI(EGL_OPENGL_API);
+
+        const auto config(gls::egl::chooseConfigs
+                          (dpy, { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT
+                                  , EGL_NONE }));
+        const auto ctx(gls::egl::context
+                       (dpy, config
+                        , { EGL_CONTEXT_MAJOR_VERSION, 3
+                            , EGL_CONTEXT_MINOR_VERSION, 3
+                            , EGL_CONTEXT_OPENGL_PROFILE_MASK
+                            , EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT
+                            , EGL_NONE }));
+        ctx.makeCurrent();
+
+        std::printf("%s, %ldx%ld, %d frames\n"
+                    , reinterpret_cast<const char*>
+                    (::glGetString(GL_RENDERER)), width, height, frames);
+
+        gls::FrameBuffer fb(math::Size2(width, height)
+                            , gls::PixelType::rgba8);
+        fb.bind();
+        ::glViewport(0, 0, width, height);
+
+        Renderer render;
+
+        // warm-up
+        render(0);
+        ::glFinish();
+
+        std::size_t sum(synchronous(fb, render, frames));
+        for (auto depth : depths) {
+            if (depth) { sum += ring(fb, render, frames, depth); }
+        }
+
+        // keeps consume() alive
+        if (!sum) { std::printf("(empty output)\n"); }
+    } catch (const std::exception &e) {
+        std::cerr << "readback-bench: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "dbglog/dbglog.hpp"
+
+#include "./uniformblock.hpp"
+#include "./extensions.hpp"
+#include "./glerror.hpp"
+
+namespace glsupport {
+
+namespace {
+
+/** Strips block name prefix and array suffix.
+ */
+std::string memberName(const std::string &name, const std::string &block)
+{
+    auto out(name);
+    if (!out.compare(0, block.size() + 1, block + ".")) {
+        out.erase(0, block.size() + 1);
+    }
+
+    const auto bracket(out.find('['));
+    if (bracket != std::string::npos) { out.erase(bracket); }
+    return out;
+}
+
+} // namespace
+
+const UniformBlockLayout::Member*
+UniformBlockLayout::member(const std::string &name) const
+{
+    for (const auto &m : members) {
+        if (m.name == name) { return &m; }
+    }
+    return nullptr;
+}
+
+UniformBlockLayout UniformBlockLayout::reflect(const Program &program
+                                               , const Name &block)
+{
+    UniformBlockLayout layout;
+    layout.name = block.name();
+    layout.index = program.uniformBlock(block);
+    if (layout.index == GL_INVALID_INDEX) {
+        LOGTHROW(err2, Error)
+            << "Program has no active uniform block <" << block.name()
+            << ">.";
+    }
+
+    const auto p(program.get());
+    ::GLint count(0);
+    ::glGetActiveUniformBlockiv(p, layout.index, GL_UNIFORM_BLOCK_DATA_SIZE
+                                , &layout.dataSize);
+    ::glGetActiveUniformBlockiv(p, layout.index
+                                , GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+
+    std::vector< ::GLint> indices(count);
+    ::glGetActiveUniformBlockiv(p, layout.index
+                                , GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES
+                                , indices.data());
+    const std::vector< ::GLuint> uindices(indices.begin(), indices.end());
+
+    auto query([&](::GLenum pname) -> std::vector< ::GLint>
+    {
+        std::vector< ::GLint> values(count);
+        ::glGetActiveUniformsiv(p, count, uindices.data(), pname
+                                , values.data());
+        return values;
+    });
+
+    const auto offsets(query(GL_UNIFORM_OFFSET));
+    const auto types(query(GL_UNIFORM_TYPE));
+    const auto sizes(query(GL_UNIFORM_SIZE));
+    const auto arrayStrides(query(GL_UNIFORM_ARRAY_STRIDE));
+    const auto matrixStrides(query(GL_UNIFORM_MATRIX_STRIDE));
+
+    ::GLint maxLength(0);
+    ::glGetProgramiv(p, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buffer(maxLength + 1);
+
+    for (::GLint i(0); i < count; ++i) {
+        ::GLsizei length(0);
+        ::glGetActiveUniformName(p, uindices[i], buffer.size(), &length
+                                 , buffer.data());
+        layout.members.push_back
+            ({ memberName(std::string(buffer.data(), length), layout.name)
+                    , offsets[i], ::GLenum(types[i]), sizes[i]
+                    , arrayStrides[i], matrixStrides[i] });
+    }
+
+    std::sort(layout.members.begin(), layout.members.end()
+              , [](const Member &l, const Member &r) {
+                  return l.offset < r.offset;
+              });
+
+    checkGl("UniformBlockLayout::reflect");
+    return layout;
+}
+
+namespace std140 {
+
+void verify(const UniformBlockLayout &layout, const Field *fields
+            , std::size_t count, std::size_t size)
+{
+    std::ostringstream errors;
+    auto fail([&](const std::string &member) -> std::ostream&
+    {
+        return errors << "\n    <" << member << ">: ";
+    });
+
+    for (const auto *f(fields), *e(fields + count); f != e; ++f) {
+        const auto *m(layout.member(f->name));
+        if (!m) {
+            fail(f->name) << "not in program's block.";
+            continue;
+        }
+
+        if (::GLint(f->offset) != m->offset) {
+            fail(f->name) << "offset " << f->offset << " != "
+                          << m->offset << " in program.";
+        }
+        if (f->type != m->type) {
+            fail(f->name) << "type 0x" << std::hex << f->type
+                          << " != 0x" << m->type << std::dec
+                          << " in program.";
+        }
+        if (::GLint(f->count) != m->size) {
+            fail(f->name) << f->count << " element(s) != " << m->size
+                          << " in program.";
+        }
+        if ((m->size > 1)
+            && (::GLint(f->size / f->count) != m->arrayStride))
+        {
+            fail(f->name) << "array stride " << (f->size / f->count)
+                          << " != " << m->arrayStride << " in program.";
+        }
+        if (m->matrixStride && (m->matrixStride != 16)) {
+            fail(f->name) << "matrix stride " << m->matrixStride
+                          << " != 16 (row_major?).";
+        }
+    }
+
+    for (const auto &m : layout.members) {
+        if (std::none_of(fields, fields + count, [&](const Field &f) {
+                    return m.name == f.name;
+                }))
+        {
+            fail(m.name) << "missing in C++ structure.";
+        }
+    }
+
+    if (::GLint(size) > layout.dataSize) {
+        fail("*") << "C++ structure size " << size << " > block size "
+                  << layout.dataSize << ".";
+    }
+
+    if (!errors.str().empty()) {
+        LOGTHROW(err2, Error)
+            << "Uniform block <" << layout.name
+            << "> does not match its C++ structure:" << errors.str();
+    }
+}
+
+} // namespace std140
+
+UniformBindings& UniformBindings::operator()(::GLuint binding
+                                             , ::GLuint buffer
+                                             , ::GLintptr offset
+                                             , ::GLsizeiptr size)
+{
+    // kept sorted by binding point, bind() groups consecutive points
+    auto ib(std::lower_bound(bindings_.begin(), bindings_.end(), binding
+                             , [](const Binding &b, ::GLuint binding)
+                             {
+                                 return b.binding < binding;
+                             }));
+    if ((ib != bindings_.end()) && (ib->binding == binding)) {
+        *ib = { binding, buffer, offset, size };
+    } else {
+        bindings_.insert(ib, { binding, buffer, offset, size });
+    }
+    return *this;
+}
+
+bool UniformBindings::multiBindAvailable()
+{
+    ::GLint major(0), minor(0);
+    ::glGetIntegerv(GL_MAJOR_VERSION, &major);
+    ::glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return (((major << 8) | minor) >= 0x404)
+        || hasExtension("GL_ARB_multi_bind");
+}
+
+void UniformBindings::bind() const
+{
+    if (bindings_.empty()) { return; }
+
+    if (multiBind_ < 0) { multiBind_ = multiBindAvailable(); }
+
+    if (!multiBind_ || (bindings_.size() == 1)) {
+        for (const auto &b : bindings_) {
+            ::glBindBufferRange(GL_UNIFORM_BUFFER, b.binding, b.buffer
+                                , b.offset, b.size);
+        }
+        return;
+    }
+
+    // one call per run of consecutive binding points, points outside the
+    // set are left untouched
+    std::vector< ::GLuint> buffers;
+    std::vector< ::GLintptr> offsets;
+    std::vector< ::GLsizeiptr> sizes;
+    for (auto ib(bindings_.begin()), eb(bindings_.end()); ib != eb; ) {
+        const auto first(ib->binding);
+        buffers.clear();
+        offsets.clear();
+        sizes.clear();
+        do {
+            buffers.push_back(ib->buffer);
+            offsets.push_back(ib->offset);
+            sizes.push_back(ib->size);
+            ++ib;
+        } while ((ib != eb)
+                 && (ib->binding == first + ::GLuint(buffers.size())));
+
+        if (buffers.size() == 1) {
+            ::glBindBufferRange(GL_UNIFORM_BUFFER, first, buffers.front()
+                                , offsets.front(), sizes.front());
+        } else {
+            ::glBindBuffersRange(GL_UNIFORM_BUFFER, first
+                                 , ::GLsizei(buffers.size())
+                                 , buffers.data(), offsets.data()
+                                 , sizes.data());
+        }
+    }
+}
+
+} // namespace glsupport
@@ -0,0 +1,381 @@
+/**
+ * Copyright (c) 2018 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef uniformblock_hpp_included_
+#define uniformblock_hpp_included_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "utility/gl.hpp"
+
+#include "./shader.hpp"
+#include "./streambuffer.hpp"
+
+namespace glsupport {
+
+/** Layout of uniform block reflected from linked program.
+ */
+struct UniformBlockLayout {
+    struct Member {
+        /** Member name without block name prefix and without array
+         *  suffix.
+         */
+        std::string name;
+        ::GLint offset;
+
+        /** GL type (GL_FLOAT_VEC4...).
+         */
+        ::GLenum type;
+
+        /** Number of array elements, 1 for non-arrays.
+         */
+        ::GLint size;
+        ::GLint arrayStride;
+        ::GLint matrixStride;
+    };
+
+    typedef std::vector<Member> Members;
+
+    std::string name;
+    ::GLuint index;
+
+    /** Minimum buffer size.
+     */
+    ::GLint dataSize;
+
+    /** Members sorted by offset.
+     */
+    Members members;
+
+    UniformBlockLayout() : index(GL_INVALID_INDEX), dataSize() {}
+
+    const Member* member(const std::string &name) const;
+
+    /** Reflects layout of given block; throws when program has no such
+     *  active block.
+     */
+    static UniformBlockLayout reflect(const Program &program
+                                      , const Name &block);
+};
+
+/** std140 layout helpers.
+ *
+ *  Uniform block is mirrored by a standard-layout C++ struct using types
+ *  from this namespace (and float, std::int32_t, std::uint32_t), which
+ *  lists its members via static fields() function:
+ *
+ *      // layout(std140) uniform Light {
+ *      //     vec4 color; vec3 direction; float intensity; mat4 shadow;
+ *      // };
+ *      struct Light {
+ *          std140::vec4 color;
+ *          std140::vec3 direction;
+ *          float intensity;
+ *          std140::mat4 shadow;
+ *
+ *          static const char* blockName() { return "Light"; }
+ *          static constexpr auto fields() {
+ *              return std140::fields
+ *                  (GLSUPPORT_STD140_FIELD(Light, color)
+ *                   , GLSUPPORT_STD140_FIELD(Light, direction)
+ *                   , GLSUPPORT_STD140_FIELD(Light, intensity)
+ *                   , GLSUPPORT_STD140_FIELD(Light, shadow));
+ *          }
+ *      };
+ *
+ *  C++ offsets are checked against std140 rules at compile time (see
+ *  UniformBlock) and against offsets reflected from program at run time.
+ *  Padding has to be explicit (e.g. vec3 is 12 bytes but 16-byte aligned).
+ *
+ *  Matrices are column-major with columns padded to vec4. In arrays every
+ *  element is 16-byte aligned, therefore only arrays of 16-byte types
+ *  (vec4, ivec4, uvec4, matrices) are supported. Nested structures are not
+ *  supported.
+ */
+namespace std140 {
+
+struct vec2 { float x, y; };
+struct vec3 { float x, y, z; };
+struct vec4 { float x, y, z, w; };
+struct ivec2 { std::int32_t x, y; };
+struct ivec3 { std::int32_t x, y, z; };
+struct ivec4 { std::int32_t x, y, z, w; };
+struct uvec2 { std::uint32_t x, y; };
+struct uvec3 { std::uint32_t x, y, z; };
+struct uvec4 { std::uint32_t x, y, z, w; };
+struct mat2 { vec4 columns[2]; };
+struct mat3 { vec4 columns[3]; };
+struct mat4 { vec4 columns[4]; };
+
+/** std140 properties of a C++ type.
+ */
+template <typename T> struct Traits;
+
+/** Block member description.
+ */
+struct Field {
+    const char *name;
+    std::size_t offset;
+    std::size_t alignment;
+    std::size_t size;
+    ::GLenum type;
+
+    /** Number of array elements, 1 for non-arrays.
+     */
+    std::size_t count;
+};
+
+template <typename T>
+constexpr Field field(const char *name, std::size_t offset);
+
+template <typename ...Fields>
+constexpr std::array<Field, sizeof...(Fields)> fields(Fields ...f);
+
+/** Index of first field violating std140 rules, number of fields if none.
+ */
+template <std::size_t N>
+constexpr std::size_t invalid(const std::array<Field, N> &fields);
+
+template <std::size_t N>
+constexpr bool valid(const std::array<Field, N> &fields) {
+    return invalid(fields) == N;
+}
+
+/** Checks fields against reflected layout, throws on any mismatch.
+ *
+ * \param size size of C++ structure
+ */
+void verify(const UniformBlockLayout &layout, const Field *fields
+            , std::size_t count, std::size_t size);
+
+} // namespace std140
+
+#define GLSUPPORT_STD140_FIELD(Struct, member)                          \
+    ::glsupport::std140::field<decltype(Struct::member)>                \
+        (#member, offsetof(Struct, member))
+
+/** Typed uniform block, T is std140 mirror of the block (see std140).
+ *
+ *  Usage:
+ *      // after link
+ *      UniformBlock<Light>::setup(program, 0);
+ *      // per draw
+ *      auto a(UniformBlock<Light>::upload(stream, light));
+ *      UniformBindings()(0, a).bind();
+ */
+template <typename T>
+class UniformBlock {
+public:
+    static_assert(std140::valid(T::fields())
+                  , "Uniform block structure violates std140 layout.");
+
+    /** Verifies layout of T::blockName() in the program against T and
+     *  assigns the block given binding point. Throws on mismatch.
+     */
+    static void setup(const Program &program, ::GLuint binding);
+
+    /** Copies value into stream buffer: one memcpy, no GL call in
+     *  persistent mode.
+     *
+     *  Allocation is aligned to given alignment; 0 uses stream's
+     *  uniformAlignment(), the stream may have been created for another
+     *  target.
+     */
+    static StreamBuffer::Allocation upload(StreamBuffer &stream
+                                           , const T &value
+                                           , ::GLsizeiptr alignment = 0);
+};
+
+/** Set of uniform buffer bindings applied at once.
+ *
+ *  Uses single glBindBuffersRange (GL 4.4 or GL_ARB_multi_bind) for each
+ *  run of consecutive binding points (points not in the set are left
+ *  untouched), falls back to glBindBufferRange per binding point
+ *  otherwise.
+ */
+class UniformBindings {
+public:
+    /** Multi-bind support is queried on first bind() in the context
+     *  current at that time.
+     */
+    UniformBindings() : multiBind_(-1) {}
+
+    /** Uses given multi-bind support (see multiBindAvailable()) of the
+     *  context this set is going to be bound in.
+     */
+    explicit UniformBindings(bool multiBind) : multiBind_(multiBind) {}
+
+    UniformBindings& operator()(::GLuint binding, ::GLuint buffer
+                                , ::GLintptr offset, ::GLsizeiptr size);
+
+    UniformBindings& operator()(::GLuint binding
+                                , const StreamBuffer::Allocation &a) {
+        return operator()(binding, a.buffer, a.offset, a.size);
+    }
+
+    void bind() const;
+
+    void clear() { bindings_.clear(); }
+
+    bool empty() const { return bindings_.empty(); }
+
+    /** Checks for glBindBuffersRange support in current context.
+     */
+    static bool multiBindAvailable();
+
+private:
+    struct Binding {
+        ::GLuint binding;
+        ::GLuint buffer;
+        ::GLintptr offset;
+        ::GLsizeiptr size;
+    };
+
+    std::vector<Binding> bindings_;
+
+    /** -1: unknown, 0/1: (not) available.
+     */
+    mutable int multiBind_;
+};
+
+// inlines
+
+namespace std140 {
+
+namespace detail {
+
+template <std::size_t Alignment, std::size_t Size, ::GLenum Type>
+struct TraitsBase {
+    static constexpr std::size_t alignment = Alignment;
+    static constexpr std::size_t size = Size;
+    static constexpr ::GLenum type = Type;
+    static constexpr std::size_t count = 1;
+};
+
+} // namespace detail
+
+template <> struct Traits<float>
+    : detail::TraitsBase<4, 4, GL_FLOAT> {};
+template <> struct Traits<std::int32_t>
+    : detail::TraitsBase<4, 4, GL_INT> {};
+template <> struct Traits<std::uint32_t>
+    : detail::TraitsBase<4, 4, GL_UNSIGNED_INT> {};
+template <> struct Traits<vec2>
+    : detail::TraitsBase<8, 8, GL_FLOAT_VEC2> {};
+template <> struct Traits<vec3>
+    : detail::TraitsBase<16, 12, GL_FLOAT_VEC3> {};
+template <> struct Traits<vec4>
+    : detail::TraitsBase<16, 16, GL_FLOAT_VEC4> {};
+template <> struct Traits<ivec2>
+    : detail::TraitsBase<8, 8, GL_INT_VEC2> {};
+template <> struct Traits<ivec3>
+    : detail::TraitsBase<16, 12, GL_INT_VEC3> {};
+template <> struct Traits<ivec4>
+    : detail::TraitsBase<16, 16, GL_INT_VEC4> {};
+template <> struct Traits<uvec2>
+    : detail::TraitsBase<8, 8, GL_UNSIGNED_INT_VEC2> {};
+template <> struct Traits<uvec3>
+    : detail::TraitsBase<16, 12, GL_UNSIGNED_INT_VEC3> {};
+template <> struct Traits<uvec4>
+    : detail::TraitsBase<16, 16, GL_UNSIGNED_INT_VEC4> {};
+template <> struct Traits<mat2>
+    : detail::TraitsBase<16, 32, GL_FLOAT_MAT2> {};
+template <> struct Traits<mat3>
+    : detail::TraitsBase<16, 48, GL_FLOAT_MAT3> {};
+template <> struct Traits<mat4>
+    : detail::TraitsBase<16, 64, GL_FLOAT_MAT4> {};
+
+template <typename T, std::size_t N>
+struct Traits<T[N]> {
+    static_assert(!(Traits<T>::size % 16)
+                  , "std140 array element must be 16-byte multiple "
+                  "(use vec4, ivec4, uvec4 or matrix).");
+    static constexpr std::size_t alignment = 16;
+    static constexpr std::size_t size = N * Traits<T>::size;
+    static constexpr ::GLenum type = Traits<T>::type;
+    static constexpr std::size_t count = N;
+};
+
+template <typename T>
+constexpr Field field(const char *name, std::size_t offset)
+{
+    static_assert(sizeof(T) == Traits<T>::size
+                  , "Unexpected size of std140 type.");
+    return { name, offset, Traits<T>::alignment, Traits<T>::size
+            , Traits<T>::type, Traits<T>::count };
+}
+
+template <typename ...Fields>
+constexpr std::array<Field, sizeof...(Fields)> fields(Fields ...f)
+{
+    return {{ f... }};
+}
+
+template <std::size_t N>
+constexpr std::size_t invalid(const std::array<Field, N> &fields)
+{
+    std::size_t offset(0);
+    for (std::size_t i(0); i < N; ++i) {
+        const auto &f(fields[i]);
+        offset = ((offset + f.alignment - 1) / f.alignment) * f.alignment;
+        if (f.offset != offset) { return i; }
+        offset += f.size;
+    }
+    return N;
+}
+
+} // namespace std140
+
+template <typename T>
+void UniformBlock<T>::setup(const Program &program, ::GLuint binding)
+{
+    const auto layout(UniformBlockLayout::reflect(program, T::blockName()));
+    const auto fields(T::fields());
+    std140::verify(layout, fields.data(), fields.size(), sizeof(T));
+    ::glUniformBlockBinding(program.get(), layout.index, binding);
+}
+
+template <typename T>
+StreamBuffer::Allocation UniformBlock<T>::upload(StreamBuffer &stream
+                                                 , const T &value
+                                                 , ::GLsizeiptr alignment)
+{
+    auto a(stream.allocate(sizeof(T)
+                           , alignment ? alignment
+                           : stream.uniformAlignment()));
+    std::memcpy(a.data, &value, sizeof(T));
+    stream.commit();
+    return a;
+}
+
+} // namespace glsupport
+
+#endif // uniformblock_hpp_included_